@@ -0,0 +1,503 @@
+// Kernel Benchmark Image
+// Rhealstone-style measurements of the kernel hot paths
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target Platform: EK-TM4C123GXL Evaluation Board
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+// Build:
+//   Add RTOS_BENCHMARK to the predefined symbols of a build configuration.
+//   That configuration links this main() instead of the demo in rtos.c.
+// Output (UART0, 115,200 baud, 8N1), one result per line:
+//   BENCH,BEGIN
+//   BENCH,<name>,<cycles>,<iterations>
+//   BENCH,<name>,PASS|FAIL         (ordering checks)
+//   BENCH,<name>_hist,<bound>,<n>  (n samples below bound cycles, above the previous bound)
+//   BENCH,END
+// Cycles are the mean of the iterations, taken from Timer 2 counting up at
+// the 40 MHz system clock, with the cost of reading the timer removed.
+// The MPU stays disabled so the benchmark threads can share these globals;
+// the kernel still reprograms the SRD masks on every switch.
+
+//-----------------------------------------------------------------------------
+// Device includes, defines, and assembler directives
+//-----------------------------------------------------------------------------
+
+#ifdef RTOS_BENCHMARK
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tm4c123gh6pm.h"
+#include "clock.h"
+#include "uart0.h"
+#include "mm.h"
+#include "kernel.h"
+#include "tasks.h"
+#include "getInput.h"
+
+#define ITERATIONS 64
+#define HIST_BUCKETS 6
+
+// semaphores used to release the helper threads
+#define semPeer keyPressed
+#define semHigh keyReleased
+#define semTick flashReq
+
+// message queues
+#define qCopy     0
+#define qZeroCopy 1
+#define MSG_SIZE  MAX_MSG_SIZE
+
+// event flags
+#define evBench   1
+#define EVENT_A   0x00000001
+#define EVENT_B   0x00000002
+
+// block pool
+#define poolBench  0
+#define POOL_BLOCK 32
+
+//-----------------------------------------------------------------------------
+// Global variables
+//-----------------------------------------------------------------------------
+
+uint32_t timerOverhead = 0;
+uint32_t postTime = 0;
+uint32_t postLatency = 0;
+uint32_t tickLatency = 0;
+uint32_t handoffTime = 0;
+uint32_t msgLatency = 0;
+uint32_t bufferLatency = 0;
+uint32_t eventLatency = 0;
+volatile uint32_t eventsSeen = 0;
+uint32_t notifyLatency = 0;
+volatile uint32_t lastSeen = 0;
+volatile bool tickDone = false;
+volatile bool lockRequested = false;
+volatile bool orderStart = false;
+uint8_t wakeOrder[3];
+uint8_t wakeCount = 0;
+uint32_t wakeHist[HIST_BUCKETS];
+const uint32_t histBound[HIST_BUCKETS] = {200, 400, 2000, 8000, 40000, 0xFFFFFFFF};   // 5 us ... 1 ms, rest
+uint32_t heapMalloc[3];
+uint32_t heapFree[3];
+uint32_t poolGetTime = 0;
+uint32_t poolPutTime = 0;
+
+//-----------------------------------------------------------------------------
+// Subroutines
+//-----------------------------------------------------------------------------
+
+// Timer 2 as a free-running 32-bit up counter at the system clock
+void initBenchTimer(void)
+{
+    SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R2;
+    _delay_cycles(3);
+    TIMER2_CTL_R &= ~TIMER_CTL_TAEN;
+    TIMER2_CFG_R = TIMER_CFG_32_BIT_TIMER;
+    TIMER2_TAMR_R = TIMER_TAMR_TAMR_PERIOD | TIMER_TAMR_TACDIR;
+    TIMER2_TAILR_R = 0xFFFFFFFF;
+    TIMER2_CTL_R |= TIMER_CTL_TAEN;
+}
+
+uint32_t now(void)
+{
+    return TIMER2_TAV_R;
+}
+
+void putResult(char name[], uint32_t cycles, uint32_t iterations)
+{
+    char str[12];
+    putsUart0("BENCH,");
+    putsUart0(name);
+    putcUart0(',');
+    IntToStr(cycles, str);
+    putsUart0(str);
+    putcUart0(',');
+    IntToStr(iterations, str);
+    putsUart0(str);
+    putcUart0('\n');
+}
+
+void putHistogram(char name[], uint32_t hist[])
+{
+    uint8_t i;
+    for (i = 0; i < HIST_BUCKETS; i++)
+    {
+        putResult(name, histBound[i], hist[i]);
+    }
+}
+
+void putCheck(char name[], bool ok)
+{
+    putsUart0("BENCH,");
+    putsUart0(name);
+    putsUart0(ok ? ",PASS\n" : ",FAIL\n");
+}
+
+// Same priority as benchMain: yields back and forth during the switch test
+void benchPeer(void)
+{
+    uint8_t i;
+    while(true)
+    {
+        wait(semPeer);
+        for (i = 0; i < ITERATIONS; i++)
+        {
+            yield();
+        }
+    }
+}
+
+// Highest priority: woken by post() from benchMain, which is preempted
+// right away without yielding
+void benchHigh(void)
+{
+    uint32_t latency;
+    uint8_t i;
+    while(true)
+    {
+        wait(semHigh);
+        latency = now() - postTime - timerOverhead;
+        postLatency += latency;
+        for (i = 0; latency >= histBound[i]; i++);
+        wakeHist[i]++;
+    }
+}
+
+// Highest priority: receives every message benchMain sends, first copies
+// through qCopy, then heap buffers through qZeroCopy, which it frees
+void benchQueue(void)
+{
+    uint8_t msg[MSG_SIZE];
+    msgBuffer buf;
+    uint8_t i;
+    while(true)
+    {
+        for (i = 0; i < ITERATIONS; i++)
+        {
+            queueReceive(qCopy, msg, WAIT_FOREVER);
+            msgLatency += now() - postTime - timerOverhead;
+        }
+        for (i = 0; i < ITERATIONS; i++)
+        {
+            queueReceive(qZeroCopy, &buf, WAIT_FOREVER);
+            bufferLatency += now() - postTime - timerOverhead;
+            FreeWrapper(buf.data);
+        }
+    }
+}
+
+// Highest priority: waits for EVENT_A alone, then for EVENT_A and EVENT_B
+// together, clearing what it waited for each time
+void benchEvents(void)
+{
+    uint8_t i;
+    while(true)
+    {
+        for (i = 0; i < ITERATIONS; i++)
+        {
+            waitEventFlags(evBench, EVENT_A, EVENT_WAIT_ANY | EVENT_CLEAR, WAIT_FOREVER);
+            eventLatency += now() - postTime - timerOverhead;
+        }
+        eventsSeen = waitEventFlags(evBench, EVENT_A | EVENT_B, EVENT_WAIT_ALL | EVENT_CLEAR, WAIT_FOREVER);
+    }
+}
+
+// Highest priority: woken by notify() from benchMain, the same path as
+// benchHigh but through its own notification word instead of a semaphore
+void benchNotify(void)
+{
+    while(true)
+    {
+        notifyTake(true, WAIT_FOREVER);
+        notifyLatency += now() - postTime - timerOverhead;
+    }
+}
+
+// Highest priority: woken by the system timer while benchMain spins,
+// then contends for the mutex benchMain holds
+void benchTick(void)
+{
+    uint8_t i;
+    uint32_t t0;
+    while(true)
+    {
+        wait(semTick);
+        for (i = 0; i < ITERATIONS; i++)
+        {
+            sleep(1);
+            tickLatency += now() - lastSeen - timerOverhead;
+        }
+        tickDone = true;
+
+        wait(semTick);
+        for (i = 0; i < ITERATIONS; i++)
+        {
+            t0 = now();
+            lockRequested = true;
+            lock(resource);             // blocks until benchMain hands it over
+            handoffTime += now() - t0 - timerOverhead;
+            unlock(resource);
+            sleep(1);
+        }
+    }
+}
+
+// Wake-order waiters: once started, each sleeps (5 - priority) ticks so
+// they block on the mutex lowest priority first, then record the order in
+// which the mutex is handed to them
+void orderWaiter(uint8_t priority)
+{
+    while (!orderStart)
+    {
+        sleep(100);
+    }
+    sleep(5 - priority);
+    lock(resource);
+    wakeOrder[wakeCount++] = priority;
+    unlock(resource);
+    while(true)
+    {
+        sleep(1000);
+    }
+}
+
+void benchWaiter2(void)
+{
+    orderWaiter(2);
+}
+
+void benchWaiter3(void)
+{
+    orderWaiter(3);
+}
+
+void benchWaiter4(void)
+{
+    orderWaiter(4);
+}
+
+void benchMain(void)
+{
+    uint32_t t0, t1;
+    uint8_t i;
+    bool got;
+    uint8_t msg[MSG_SIZE] = {0};
+    msgBuffer buf;
+
+    putsUart0("BENCH,BEGIN\n");
+    putResult("timer_read", timerOverhead, 1);
+    putResult("malloc_512", heapMalloc[0], 1);
+    putResult("free_512", heapFree[0], 1);
+    putResult("malloc_1024", heapMalloc[1], 1);
+    putResult("free_1024", heapFree[1], 1);
+    putResult("malloc_4096", heapMalloc[2], 1);
+    putResult("free_4096", heapFree[2], 1);
+    putResult("pool_get_32", poolGetTime, 1);
+    putResult("pool_put_32", poolPutTime, 1);
+
+    // mutex lock + unlock without contention
+    t0 = now();
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        lock(resource);
+        unlock(resource);
+    }
+    t1 = now();
+    putResult("mutex_uncontended", (t1 - t0 - timerOverhead) / ITERATIONS, ITERATIONS);
+
+    // task switch: two equal-priority threads yielding to each other
+    post(semPeer);
+    t0 = now();
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        yield();
+    }
+    t1 = now();
+    putResult("task_switch", (t1 - t0 - timerOverhead) / (2 * ITERATIONS), ITERATIONS);
+
+    // semaphore post until the waiting higher-priority thread runs
+    // (preemption is still off: the wakeup alone must force the switch)
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        postTime = now();
+        post(semHigh);
+    }
+    putResult("post_to_wake", postLatency / ITERATIONS, ITERATIONS);
+    putHistogram("post_to_wake_hist", wakeHist);
+
+    // the same wakeup through a direct-to-task notification
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        postTime = now();
+        notify(benchNotify, NOTIFY_GIVE, 0);
+    }
+    putResult("notify_to_wake", notifyLatency / ITERATIONS, ITERATIONS);
+
+    // queue send until the waiting higher-priority receiver runs, copying
+    // a full message, then handing over a 512 B buffer without copying it
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        postTime = now();
+        queueSend(qCopy, msg, WAIT_FOREVER);
+    }
+    putResult("queue_to_wake", msgLatency / ITERATIONS, ITERATIONS);
+    buf.size = 512;
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        buf.data = MallocWrapper(buf.size);
+        postTime = now();
+        queueSend(qZeroCopy, &buf, WAIT_FOREVER);
+    }
+    putResult("queue_zero_copy_to_wake", bufferLatency / ITERATIONS, ITERATIONS);
+
+    // event flags set until the waiting higher-priority thread runs, then
+    // a wait for two flags that must not end until both are set
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        postTime = now();
+        setEventFlags(evBench, EVENT_A);
+    }
+    putResult("event_to_wake", eventLatency / ITERATIONS, ITERATIONS);
+    setEventFlags(evBench, EVENT_A);
+    got = (eventsSeen == 0);
+    setEventFlags(evBench, EVENT_B);
+    putCheck("event_wait_all", got && (eventsSeen == (EVENT_A | EVENT_B))
+             && (waitEventFlags(evBench, EVENT_A | EVENT_B, EVENT_WAIT_ANY, 0) == 0));
+
+    // preemption by a thread made ready by the system timer
+    setPreemption(true);
+    post(semTick);
+    while (!tickDone)
+    {
+        lastSeen = now();
+    }
+    putResult("preemption", tickLatency / ITERATIONS, ITERATIONS);
+
+    // mutex hand-off to a blocked higher-priority thread
+    // benchMain only runs while benchTick is blocked, so seeing the
+    // request means benchTick is already waiting on the mutex
+    lock(resource);
+    post(semTick);
+    for (i = 0; i < ITERATIONS; i++)
+    {
+        while (!lockRequested);
+        lockRequested = false;
+        unlock(resource);
+        yield();
+        lock(resource);
+    }
+    unlock(resource);
+    putResult("mutex_contended", handoffTime / ITERATIONS, ITERATIONS);
+
+    // priority-ordered wakeup: the waiters queue up lowest priority first,
+    // the mutex must still go to the highest-priority one first
+    lock(resource);
+    orderStart = true;
+    sleep(200);
+    unlock(resource);
+    sleep(10);
+    putCheck("prio_wake_order", (wakeCount == 3) && (wakeOrder[0] == 2) && (wakeOrder[1] == 3) && (wakeOrder[2] == 4));
+    setPreemption(false);
+
+    // timed wait: semTick is empty and benchTick waits on it ahead of
+    // benchMain, so the wait has to give up after 4-5 ms and leave the queue
+    t0 = now();
+    got = waitTimeout(semTick, 5);
+    t1 = now();
+    putResult("wait_timeout", t1 - t0 - timerOverhead, 1);
+    putCheck("wait_timeout", !got && (t1 - t0 >= 4 * 40000));
+
+    // a free mutex is taken at once, even without waiting
+    got = lockTimeout(resource, 0);
+    unlock(resource);
+    putCheck("lock_try", got);
+
+    putsUart0("BENCH,END\n");
+    while(true)
+    {
+        yield();
+    }
+}
+
+// Times the heap directly while still privileged, before the kernel starts
+void benchHeap(void)
+{
+    static const uint32_t sizes[3] = {512, 1024, 4096};
+    uint32_t t0;
+    void *p;
+    uint8_t i;
+    for (i = 0; i < 3; i++)
+    {
+        t0 = now();
+        p = mallocFromHeap(sizes[i]);
+        heapMalloc[i] = now() - t0 - timerOverhead;
+        t0 = now();
+        freeToHeap(p);
+        heapFree[i] = now() - t0 - timerOverhead;
+    }
+
+    // a 32-byte block from a pool instead of a whole 512-byte heap block
+    initPool(poolBench, POOL_BLOCK, 16);
+    t0 = now();
+    p = poolGetFromIsr(poolBench);
+    poolGetTime = now() - t0 - timerOverhead;
+    t0 = now();
+    poolPutFromIsr(poolBench, p);
+    poolPutTime = now() - t0 - timerOverhead;
+}
+
+//-----------------------------------------------------------------------------
+// Main
+//-----------------------------------------------------------------------------
+
+int main(void)
+{
+    bool ok;
+
+    initSystemClockTo40Mhz();
+    initHw();
+    initUart0();
+    setUart0BaudRate(115200, 40e6);
+    initBenchTimer();
+    initRtos();
+
+    // cost of reading the timer itself
+    timerOverhead = now();
+    timerOverhead = now() - timerOverhead;
+
+    initMutex(resource, QUEUE_PRIO);
+    initSemaphore(semPeer, 0, QUEUE_PRIO);
+    initSemaphore(semHigh, 0, QUEUE_PRIO);
+    initSemaphore(semTick, 0, QUEUE_PRIO);
+    initQueue(qCopy, 4, MSG_SIZE, QUEUE_COPY, QUEUE_PRIO);
+    initQueue(qZeroCopy, 4, 0, QUEUE_ZERO_COPY, QUEUE_PRIO);
+    initEventGroup(uart0Events);
+    initEventGroup(evBench);
+
+    benchHeap();
+
+    ok = createThread(idle, "Idle", 15, 512);
+    ok &= createThread(benchMain, "BenchMain", 1, 1024);
+    ok &= createThread(benchPeer, "BenchPeer", 1, 512);
+    ok &= createThread(benchHigh, "BenchHigh", 0, 512);
+    ok &= createThread(benchTick, "BenchTick", 0, 512);
+    ok &= createThread(benchQueue, "BenchQueue", 0, 512);
+    ok &= createThread(benchEvents, "BenchEvents", 0, 512);
+    ok &= createThread(benchNotify, "BenchNotify", 0, 512);
+    ok &= createThread(benchWaiter2, "BenchWait2", 2, 512);
+    ok &= createThread(benchWaiter3, "BenchWait3", 3, 512);
+    ok &= createThread(benchWaiter4, "BenchWait4", 4, 512);
+
+    if (ok)
+        startRtos(); // never returns
+    else
+        while(true);
+}
+
+#endif
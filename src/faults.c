@@ -117,6 +117,9 @@ void mpuFaultIsr(void)
     putsUart0(str);
     putsUart0("\n");
 
+    //Clears the data/instruction access violation flags
+    NVIC_FAULT_STAT_R = NVIC_FAULT_STAT_DERR | NVIC_FAULT_STAT_IERR;
+
     //Clears MPU fault pending bit
     NVIC_SYS_HND_CTRL_R &= ~(NVIC_SYS_HND_CTRL_MEMP);
 
@@ -214,6 +217,7 @@ void hardFaultIsr(void)
     putsUart0(str);
     putsUart0("\n");
 
+    flushUart0();
     while(1);
 }
 
@@ -228,6 +232,7 @@ void busFaultIsr(void)
     putsUart0(str);
     putsUart0("\n");
 
+    flushUart0();
     while(1);
 }
 
@@ -242,6 +247,7 @@ void usageFaultIsr(void)
     putsUart0(str);
     putsUart0("\n");
 
+    flushUart0();
     while(1);
 }
 
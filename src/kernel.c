@@ -19,18 +19,32 @@
 #include "sp.h"
 #include "getInput.h"
 #include "uart0.h"
+#include "svc.h"
 
 //-----------------------------------------------------------------------------
 // RTOS Defines and Kernel Variables
 //-----------------------------------------------------------------------------
 
+#define FLASH_END 0x00040000         // 256 KiB of flash, readable by every task
+#define KERNEL_BASEPRI (MAX_SYSCALL_PRIORITY << 5)
+
+// task list, linked through the prev/next indices of the tcb
+typedef struct _taskList
+{
+    uint8_t head;
+    uint8_t tail;
+} taskList;
+
 // mutex
 typedef struct _mutex
 {
     bool lock;
     uint8_t queueSize;
-    uint8_t processQueue[MAX_MUTEX_QUEUE_SIZE];
+    uint8_t policy;                // QUEUE_FIFO or QUEUE_PRIO
+    taskList waiters;              // tasks blocked on the mutex
     uint8_t lockedBy;
+    uint32_t maxBlocked;           // worst-case ticks a task waited before getting the mutex
+    uint8_t maxBlockedTask;        // task that waited that long
 } mutex;
 mutex mutexes[MAX_MUTEXES];
 
@@ -39,10 +53,41 @@ typedef struct _semaphore
 {
     uint8_t count;
     uint8_t queueSize;
-    uint8_t processQueue[MAX_SEMAPHORE_QUEUE_SIZE];
+    uint8_t policy;                // QUEUE_FIFO or QUEUE_PRIO
+    taskList waiters;              // tasks blocked on the semaphore
 } semaphore;
 semaphore semaphores[MAX_SEMAPHORES];
 
+// message queue
+// A ring of depth slots of msgSize bytes. A zero-copy queue holds msgBuffer
+// descriptors and moves the buffer's MPU window instead of its bytes.
+typedef struct _msgQueue
+{
+    uint8_t depth;                 // 0 until initQueue()
+    uint8_t msgSize;
+    uint8_t mode;                  // QUEUE_COPY or QUEUE_ZERO_COPY
+    uint8_t policy;                // QUEUE_FIFO or QUEUE_PRIO
+    uint8_t head;                  // slot of the oldest message
+    uint8_t count;                 // messages in the queue
+    uint8_t maxCount;              // high-water mark of count
+    taskList senders;              // tasks blocked on a full queue
+    taskList receivers;            // tasks blocked on an empty queue
+    uint8_t data[MAX_QUEUE_DEPTH * MAX_MSG_SIZE];
+} msgQueue;
+msgQueue queues[MAX_QUEUES];
+
+// event flag group
+typedef struct _eventGroup
+{
+    bool used;
+    uint32_t flags;
+    taskList waiters;              // tasks blocked until their mask is satisfied
+} eventGroup;
+eventGroup eventGroups[MAX_EVENT_GROUPS];
+
+// fixed-size block pools (see createBlockPool() in mm.c)
+blockPool pools[MAX_POOLS];
+
 // task states
 #define STATE_INVALID           0 // no task
 #define STATE_STOPPED           1 // stopped, all memory freed
@@ -50,18 +95,79 @@ semaphore semaphores[MAX_SEMAPHORES];
 #define STATE_DELAYED           3 // has run, but now awaiting timer
 #define STATE_BLOCKED_MUTEX     4 // has run, but now blocked by semaphore
 #define STATE_BLOCKED_SEMAPHORE 5 // has run, but now blocked by semaphore
+#define STATE_BLOCKED_SEND      6 // has run, but now blocked sending to a full queue
+#define STATE_BLOCKED_RECEIVE   7 // has run, but now blocked receiving from an empty queue
+#define STATE_BLOCKED_EVENT     8 // has run, but now blocked on event flags
+#define STATE_BLOCKED_NOTIFY    9 // has run, but now waiting for a notification
 
 // task
 uint8_t taskCurrent = 0;          // index of last dispatched task
 uint8_t taskCount = 0;            // total number of valid tasks
 
 // control
-bool priorityScheduler = true;    // priority (true) or round-robin (false)
+uint8_t schedulerMode = SCHED_PRIO; // SCHED_PRIO, SCHED_RR or SCHED_EDF
 bool priorityInheritance = false; // priority inheritance for mutexes
 bool preemption = false;          // preemption (true) or cooperative (false)
 
+// system timer
+#define SYSTICK_RELOAD_1MS 39999                                 // 40 MHz system clock @ 1 kHz = 40,000 - 1
+#define CYCLES_PER_TICK    40000
+#define MAX_IDLE_TICKS     (0xFFFFFF / CYCLES_PER_TICK)          // longest period the 24-bit SysTick can count
+uint32_t systemTicks = 0;         // ms elapsed since the RTOS started
+uint32_t stretchTicks = 1;        // number of 1 ms ticks the current SysTick period covers
+
+// DWT cycle counter (not defined in tm4c123gh6pm.h)
+#define DWT_CTRL_R          (*((volatile uint32_t *)0xE0001000))
+#define DWT_CYCCNT_R        (*((volatile uint32_t *)0xE0001004))
+#define DWT_CTRL_CYCCNTENA  0x00000001
+#define NVIC_DBG_INT_TRCENA 0x01000000  // enables the DWT block
+#define CYCLES_PER_US       40
+
+// CPU accounting
+// Every context switch charges the cycles since the previous switch to the
+// outgoing task. Each task has two counters: one accumulates the current
+// window while ps reads the other, which holds the last complete window.
+#define CPU_WINDOW_MS       1000        // length of a measurement window
+#define LOAD_1S             1000        // time constants of the load averages (ms)
+#define LOAD_5S             5000
+#define LOAD_15S            15000
+uint8_t cpuActive = 0;            // counter being filled in the current window
+uint32_t cpuWindowStart = 0;      // systemTicks when the current window began
+uint32_t cpuWindowCycles = 0;     // length of the last complete window in cycles
+uint32_t lastSwitchCycles = 0;    // DWT_CYCCNT at the previous context switch
+uint32_t cpuIdle = 0;             // idle time in the last window (hundredths of %)
+int32_t cpuLoad[3] = {0, 0, 0};   // 1/5/15 s load averages (hundredths of %)
+
+// Stack high-water marks
+// Every stack is filled with STACK_FILL when it is allocated. The idle task
+// calls scanStacks() on each pass, which checks at most STACK_SCAN_WORDS
+// words of one stack, walking up from its base to the deepest use found so
+// far. The first overwritten word sets a new peak and the walk restarts at
+// the base; once it reaches the known peak it moves on to the next thread.
+#define STACK_FILL          0xA5A5A5A5
+#define STACK_SCAN_WORDS    32
+uint8_t stackScanTask = 0;        // thread whose stack the idle scan is walking
+
+// FPU context
+// pushREGS saves the EXC_RETURN of the outgoing task below R4-R11. Bit 4 is
+// clear when the hardware stacked an extended frame (S0-S15, FPSCR), and only
+// then are S16-S31 saved too. New threads start with a basic frame.
+#define EXC_RETURN_THREAD_PSP 0xFFFFFFFD    // thread mode, PSP, no FP context
+#define EXC_RETURN_NO_FPU     0x00000010    // clear if the frame holds an FP context
+
+// Wrappers without a result issue the call inline. The ones that return a
+// value are in sp.s, where the result the handler left in R0 is returned
+// explicitly instead of relying on R0 surviving an asm statement.
+#define STRINGIFY(x) #x
+#define SYSCALL(n)   __asm("  MOV R12, #" STRINGIFY(n) "\n  SVC #0")
+
+typedef uint32_t (*_syscall)(uint32_t r0, uint32_t r1, uint32_t r2, uint32_t r3);
+
 // tcb
 #define NUM_PRIORITIES   16
+#define IDLE_PRIORITY    (NUM_PRIORITIES - 1)
+#define NO_TASK          0xFF
+#define NO_PERIODIC      0xFF
 struct _tcb
 {
     uint8_t state;                 // see STATE_ values above
@@ -69,666 +175,2358 @@ struct _tcb
     void *spInit;                  // original top of stack
     void *sp;                      // current stack pointer
     uint8_t priority;              // 0=highest
-    //uint8_t currentPriority;       // 0=highest (needed for pi)
+    uint8_t currentPriority;       // 0=highest (needed for pi)
     uint32_t* BaseAddress;
-    uint32_t ticks;                // ticks until sleep complete
+    uint32_t ticks;                // ticks after the previous entry of the wakeup list
     uint64_t srd;                  // MPU subregion disable bits
+    uint32_t sramAttr[SRAM_REGIONS]; // srd as the RASR values of regions 2-6, loaded on every switch
     char name[16];                 // name of task used in ps command
     uint8_t mutex;                 // index of the mutex in use or blocking the thread
     uint8_t semaphore;             // index of the semaphore that is blocking the thread
+    uint8_t queue;                 // index of the message queue that is blocking the thread
+    void *msg;                     // message being sent or received while blocked on the queue
+    uint8_t eventGroup;            // index of the event flag group the thread waits on
+    uint8_t eventOptions;          // EVENT_ options of the wait
+    uint32_t eventMask;            // flags the thread waits for
+    uint32_t notifyValue;          // notification word
+    bool notifyClear;              // notifyTake() in progress clears the word instead of decrementing it
+    uint32_t blockedAt;            // systemTicks when the thread blocked on the mutex
+    uint8_t periodic;              // entry in periodics (NO_PERIODIC if the thread has no period)
+    bool releasePending;           // waiting in waitNextPeriod() for the next release
+    uint32_t relDeadline;          // deadline relative to each release (0 = no deadline)
+    uint32_t absDeadline;          // systemTicks by which the current job must finish
+    uint32_t cpuTime[2];           // cycles run in the current and last window
+    bool fpuUsed;                  // has been switched out with an FP context
     uint32_t* Allocation;
+    void *received;                // last zero-copy heap buffer handed to the task, freed if it is killed
     uint32_t ThreadSize;
+    uint32_t stackPeak;            // deepest stack use found by the idle scan (bytes)
+    uint32_t *stackScan;           // next stack word the idle scan checks
+    uint8_t prev;                  // previous task in the ready or wait queue (NO_TASK if head)
+    uint8_t next;                  // next task in the ready or wait queue (NO_TASK if tail)
+    uint8_t timerPrev;             // previous task in the wakeup list
+    uint8_t timerNext;             // next task in the wakeup list
+    bool timedWait;                // blocked with a timeout, so also in the wakeup list
 } tcb[MAX_TASKS];
 
+// periodic threads
+// Release times and timing statistics of the threads created with
+// createPeriodicThread(), kept out of the tcb so other threads do not pay
+// for them. An entry is taken for good when its thread is created.
+typedef struct _periodicThread
+{
+    uint32_t period;               // release period in ticks (0 = entry free)
+    uint32_t release;              // systemTicks of the current job's scheduled release
+    uint32_t releaseCycles;        // DWT_CYCCNT at the scheduled release
+    bool jitterPending;            // released but not dispatched yet
+    bool paced;                    // has called waitNextPeriod(), which alone releases its jobs
+    uint32_t deadlineMisses;       // jobs that finished after their deadline
+    uint32_t jitterMin;            // release-to-dispatch delay (us)
+    uint32_t jitterMax;
+    uint64_t jitterSum;
+    uint32_t jitterCount;
+} periodicThread;
+periodicThread periodics[MAX_PERIODIC];
+
+// ready queues
+// One FIFO per effective priority level. Bit (15 - priority) of readyBitmap is set
+// while that level has a READY task, so CLZ returns the highest level.
+taskList readyQueue[NUM_PRIORITIES];
+uint16_t readyBitmap = 0;
+
+// wakeup list
+// DELAYED tasks sorted by wakeup time. Each entry's ticks field holds the
+// delay relative to the entry before it, so the tick only touches the head.
+uint8_t timerHead = NO_TASK;
+
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
-bool initMutex(uint8_t mutex)
+void initTaskList(taskList *list)
 {
-    bool ok = (mutex < MAX_MUTEXES);
-    if (ok)
-    {
-        mutexes[mutex].lock = false;
-        mutexes[mutex].lockedBy = 0;
-    }
-    return ok;
+    list->head = NO_TASK;
+    list->tail = NO_TASK;
 }
 
-bool initSemaphore(uint8_t semaphore, uint8_t count)
+// Appends a task to the end of a list
+void insertTaskTail(taskList *list, uint8_t task)
 {
-    bool ok = (semaphore < MAX_SEMAPHORES);
-    {
-        semaphores[semaphore].count = count;
-    }
-    return ok;
+    tcb[task].next = NO_TASK;
+    tcb[task].prev = list->tail;
+    if (list->tail == NO_TASK)
+        list->head = task;
+    else
+        tcb[list->tail].next = task;
+    list->tail = task;
 }
 
-// REQUIRED: initialize systick for 1ms system timer
-void initRtos(void)
+// Inserts a task ahead of another one (at the tail if next is NO_TASK)
+void insertTaskBefore(taskList *list, uint8_t next, uint8_t task)
 {
-    uint8_t i;
-    // no tasks running
-    taskCount = 0;
-    // clear out tcb records
-    for (i = 0; i < MAX_TASKS; i++)
+    if (next == NO_TASK)
     {
-        tcb[i].state = STATE_INVALID;
-        tcb[i].pid = 0;
+        insertTaskTail(list, task);
+        return;
     }
+    tcb[task].next = next;
+    tcb[task].prev = tcb[next].prev;
+    if (tcb[next].prev == NO_TASK)
+        list->head = task;
+    else
+        tcb[tcb[next].prev].next = task;
+    tcb[next].prev = task;
+}
 
-    NVIC_ST_RELOAD_R |= 39999;      //40Mhz system clock @ 1 Khz = 40,000 - 1
-    NVIC_ST_CTRL_R |= NVIC_ST_CTRL_CLK_SRC | NVIC_ST_CTRL_INTEN | NVIC_ST_CTRL_ENABLE;  //Enables Systick Timer and interrupt generation
+// Unlinks a task from anywhere in a list
+void removeTask(taskList *list, uint8_t task)
+{
+    if (tcb[task].prev == NO_TASK)
+        list->head = tcb[task].next;
+    else
+        tcb[tcb[task].prev].next = tcb[task].next;
+
+    if (tcb[task].next == NO_TASK)
+        list->tail = tcb[task].prev;
+    else
+        tcb[tcb[task].next].prev = tcb[task].prev;
+
+    tcb[task].prev = NO_TASK;
+    tcb[task].next = NO_TASK;
 }
 
-// REQUIRED: Implement prioritization to NUM_PRIORITIES
-// Use an array to keep track of last ran task in a priority level and
-// go through each priority level and go through the tasks to see which
-// one is at that priority index and is READY.
-uint8_t rtosScheduler(void)
+// Adds a READY task to the back of its priority level
+void readyInsert(uint8_t task)
 {
-    bool ok;
-    static uint8_t task = 0xFF;
-    ok = false;
+    uint8_t prio = tcb[task].currentPriority;
+    insertTaskTail(&readyQueue[prio], task);
+    readyBitmap |= (1 << (15 - prio));
+}
 
-    if(priorityScheduler == true)
+// Takes a task out of its priority level when it stops being READY
+void readyRemove(uint8_t task)
+{
+    uint8_t prio = tcb[task].currentPriority;
+    removeTask(&readyQueue[prio], task);
+    if (readyQueue[prio].head == NO_TASK)
     {
-        static uint8_t LastRanTask[NUM_PRIORITIES] = {0xFF};   //Array to track the last task at each prio level
-        uint8_t HighestPriority = 16;       //Start checking from lowest priority
-        uint8_t i = 0;
+        readyBitmap &= ~(1 << (15 - prio));
+    }
+}
 
-        //Note to self: Use MAX Tasks for the for loop since there is only 12 indices in the tcb. Stop thinking of the prio levels
-        for (i = 0; i < MAX_TASKS; i++)
-        {
-            //Go through each tcb index and look for READY threads at the updated priority level
-            if (tcb[i].state == STATE_READY && tcb[i].priority < HighestPriority)
-            {
-                HighestPriority = tcb[i].priority;  //update the priority level found and keep going lower if tasks at higher prio are found
-                task = i;                           //Sets the task index for the READY task
-            }
-        }
+void timerRemove(uint8_t task);
+void restorePriority(uint8_t task);
 
-        //Round robin at a priority level when there are multiple tasks
-        if (task != 0xFF)
-        {
-            //start from the last scheduled task in that priority level + 1
-            uint8_t LastScheduledTask = (LastRanTask[HighestPriority] + 1) % taskCount;
-            uint8_t j = 0;
-            for (j = 0; j < taskCount; j++)
-            {
-                uint8_t taskIndex = (LastScheduledTask + j) % taskCount;
-                if (tcb[taskIndex].state == STATE_READY && tcb[taskIndex].priority == HighestPriority)
-                {
-                    task = taskIndex;
-                    LastRanTask[HighestPriority] = taskIndex;   //update the last scheduled index for this priority
-                    break;
-                }
-            }
-        }
-        return task;
-    }
-    else                //run as round-robin
+// True if a task should run ahead of the running one under the current
+// scheduler mode (never in round-robin, which has no notion of rank)
+bool outranksCurrent(uint8_t task)
+{
+    struct _tcb *current = &tcb[taskCurrent];
+    if (schedulerMode == SCHED_RR)
+        return false;
+    if (schedulerMode == SCHED_EDF && (tcb[task].relDeadline != 0 || current->relDeadline != 0))
     {
-        while (!ok)
-        {
-            task++;
-            if (task >= MAX_TASKS)
-                task = 0;
-            ok = (tcb[task].state == STATE_READY);
-        }
-        return task;
+        if (tcb[task].relDeadline == 0)
+            return false;
+        if (current->relDeadline == 0)
+            return true;
+        return (int32_t)(tcb[task].absDeadline - current->absDeadline) < 0;
     }
-   // return 0xFF;
+    return tcb[task].currentPriority < current->currentPriority;
 }
 
-// REQUIRED: modify this function to start the operating system
-// by calling scheduler, set srd bits, setting PSP, ASP bit, call fn with fn add in R0
-// fn set TMPL bit, and PC <= fn
-void startRtos(void)
+// True if the task at the head of the highest ready level should run ahead
+// of the running one, e.g. after a priority change
+bool readyOutranksCurrent(void)
 {
-    setPSP((uint32_t*)0x20008000);
-    setASP();
-    setTMPL();
-    __asm("     SVC #0");
+    return readyBitmap != 0 && outranksCurrent(readyQueue[countLeadingZeros(readyBitmap) - 16].head);
 }
 
-// REQUIRED:
-// add task if room in task list
-// store the thread name
-// allocate stack space and store top of stack in sp and spInit
-// set the srd bits based on the memory allocation
-// initialize the created stack to make it appear the thread has run before
-bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes)
+// Makes a blocked or delayed task READY. A task that outranks the running
+// one gets the CPU as soon as the current exception returns, even with
+// preemption off (which only turns off time slicing on the tick).
+void wakeTask(uint8_t task)
 {
-    bool ok = false;
-    uint8_t i = 0;
-    bool found = false;
-    if (taskCount < MAX_TASKS)
+    if (tcb[task].timedWait)
     {
-        // make sure fn not already in list (prevent reentrancy)
-        while (!found && (i < MAX_TASKS))
+        timerRemove(task);          // got the object before its timeout ran out
+        tcb[task].timedWait = false;
+    }
+    tcb[task].state = STATE_READY;
+    readyInsert(task);
+    if (outranksCurrent(task))
+    {
+        NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+    }
+}
+
+// Wait queues
+// A task blocked on a mutex or semaphore is not READY, so the prev/next links
+// that hold the ready queues chain it into the object's wait queue instead.
+// A QUEUE_PRIO queue is kept sorted by effective priority (FIFO among equals),
+// so the head is always the waiter to wake; a QUEUE_FIFO queue keeps arrival order.
+void waitEnqueue(taskList *queue, uint8_t policy, uint8_t task)
+{
+    uint8_t next = NO_TASK;
+    if (policy == QUEUE_PRIO)
+    {
+        next = queue->head;
+        while (next != NO_TASK && tcb[next].currentPriority <= tcb[task].currentPriority)
         {
-            found = (tcb[i++].pid ==  fn);
+            next = tcb[next].next;
         }
-        if (!found)
-        {
-            // find first available tcb record
-            i = 0;
-
-            uint32_t* InitialAlloc = mallocFromHeap(stackBytes);
-            uint32_t* p = (uint32_t*)((uint32_t)InitialAlloc + RoundUp(stackBytes) - 4);
-
+    }
+    insertTaskBefore(queue, next, task);
+}
 
-            while (tcb[i].state != STATE_INVALID) {i++;}
-            tcb[i].state = STATE_READY;
-            tcb[i].pid = fn;
-            tcb[i].sp = (void*)p;  //sets current sp to top of the stack
-            tcb[i].spInit = tcb[i].sp;       //initialize sp
-            tcb[i].priority = priority;
+// Returns the list of senders or receivers a task blocked on a message queue is in
+taskList* queueWaiters(uint8_t task)
+{
+    if (tcb[task].state == STATE_BLOCKED_SEND)
+        return &queues[tcb[task].queue].senders;
+    return &queues[tcb[task].queue].receivers;
+}
 
-            StringCopy((char*)name, tcb[i].name);
-            uint64_t srdbits = createNoSramAccessMask();
-            addSramAccessWindow(&srdbits, InitialAlloc, stackBytes);   //check srd bits
-            tcb[i].srd = srdbits;
+// Takes the next waiter off a wait queue (NO_TASK if it is empty)
+uint8_t waitDequeue(taskList *queue)
+{
+    uint8_t task = queue->head;
+    if (task != NO_TASK)
+    {
+        removeTask(queue, task);
+    }
+    return task;
+}
 
-            tcb[i].BaseAddress = InitialAlloc;
-            tcb[i].ThreadSize = stackBytes;
+// Inserts a task into the wakeup list so it wakes after the given number of ticks
+void timerInsert(uint8_t task, uint32_t ticks)
+{
+    uint8_t prev = NO_TASK;
+    uint8_t next = timerHead;
 
-            //Hardware push pop
-            *(--p) = 0x01000000;     // xPSR (valid bit)
-            *(--p) = (uint32_t)tcb[i].pid;     // PC
-            *(--p) = 0x00000001;     // LR trash value doesn't matter
-            *(--p) = 0x12121212;     // R12
-            *(--p) = 0x03030303;     // R3
-            *(--p) = 0x02020202;     // R2
-            *(--p) = 0x01010101;     // R1
-            *(--p) = 0x0000001A;     // R0
-            //Software push pop
-            *(--p) = 0xDEAD0004;     // R4
-            *(--p) = 0xDEAD0005;     // R5
-            *(--p) = 0xDEAD0006;     // R6
-            *(--p) = 0xDEAD0007;     // R7
-            *(--p) = 0xDEAD0008;     // R8
-            *(--p) = 0xDEAD0009;     // R9
-            *(--p) = 0xDEAD0010;     // R10
-            *(--p) = 0xDEAD0011;     // R11
-            *(--p) = (uint32_t)0xFFFFFFFD;     // EXC_RETURN Value
+    // walk past every entry due at or before this one (FIFO for equal wakeup times)
+    while (next != NO_TASK && tcb[next].ticks <= ticks)
+    {
+        ticks -= tcb[next].ticks;
+        prev = next;
+        next = tcb[next].timerNext;
+    }
 
-            tcb[i].sp = p;
+    tcb[task].ticks = ticks;
+    tcb[task].timerPrev = prev;
+    tcb[task].timerNext = next;
+    if (prev == NO_TASK)
+        timerHead = task;
+    else
+        tcb[prev].timerNext = task;
+    if (next != NO_TASK)
+    {
+        tcb[next].timerPrev = task;
+        tcb[next].ticks -= ticks;   // successor is now relative to this task
+    }
+}
 
-            // increment task count
-            taskCount++;
-            ok = true;
-        }
+// Takes a task out of the wakeup list, handing its delay to its successor
+void timerRemove(uint8_t task)
+{
+    uint8_t prev = tcb[task].timerPrev;
+    uint8_t next = tcb[task].timerNext;
+
+    if (prev == NO_TASK)
+        timerHead = next;
+    else
+        tcb[prev].timerNext = next;
+    if (next != NO_TASK)
+    {
+        tcb[next].timerPrev = prev;
+        tcb[next].ticks += tcb[task].ticks;
     }
-    return ok;
+    tcb[task].timerPrev = NO_TASK;
+    tcb[task].timerNext = NO_TASK;
 }
 
-// REQUIRED: modify this function to restart a thread
-void restartThread(_fn fn)
+// Overwrites the value a blocked task's service call returns in R0. The task
+// has been switched out, so its frame starts with the EXC_RETURN, S16-S31
+// (if it has an FP context) and R4-R11 saved by pushREGS.
+void setSyscallResult(uint8_t task, uint32_t result)
 {
-    __asm("  SVC #14");
+    uint32_t *frame = (uint32_t*)tcb[task].sp;
+    uint32_t r0 = (frame[0] & EXC_RETURN_NO_FPU) ? 9 : 25;
+    frame[r0] = result;
 }
 
-// REQUIRED: modify this function to stop a thread
-// REQUIRED: remove any pending semaphore waiting, unlock any mutexes
-void stopThread(_fn fn)
+// Gives up a timed wait that has run out: the task leaves the object's wait
+// queue without it, and the timed call (waitTimeout(), lockTimeout(),
+// queueSend(), queueReceive(), waitEventFlags() or notifyTake()) returns 0
+void expireWait(uint8_t task)
 {
-    __asm("  SVC #13");
+    tcb[task].timedWait = false;
+    if (tcb[task].state == STATE_BLOCKED_MUTEX)
+    {
+        removeTask(&mutexes[tcb[task].mutex].waiters, task);
+        mutexes[tcb[task].mutex].queueSize--;
+        restorePriority(mutexes[tcb[task].mutex].lockedBy);     //owner no longer inherits from this task
+    }
+    else if (tcb[task].state == STATE_BLOCKED_SEMAPHORE)
+    {
+        removeTask(&semaphores[tcb[task].semaphore].waiters, task);
+        semaphores[tcb[task].semaphore].queueSize--;
+    }
+    else if (tcb[task].state == STATE_BLOCKED_EVENT)
+    {
+        removeTask(&eventGroups[tcb[task].eventGroup].waiters, task);
+    }
+    else if (tcb[task].state != STATE_BLOCKED_NOTIFY)      //a notification waiter is in no list
+    {
+        removeTask(queueWaiters(task), task);
+    }
+    setSyscallResult(task, false);
 }
 
-// REQUIRED: modify this function to set a thread priority
-void setThreadPriority(_fn fn, uint8_t priority)
+// Starts a new job of a periodic task at its scheduled release
+void releaseJob(uint8_t task, uint32_t releaseCycles)
 {
-    __asm("  SVC #15");
+    periodicThread *p = &periodics[tcb[task].periodic];
+    tcb[task].absDeadline = p->release + tcb[task].relDeadline;
+    tcb[task].releasePending = false;
+    p->releaseCycles = releaseCycles;
+    p->jitterPending = true;
 }
 
-// REQUIRED: modify this function to yield execution back to scheduler using pendsv
-void yield(void)
+// Updates the release jitter statistics the first time a job is dispatched
+void recordDispatch(uint8_t task)
 {
-    __asm("  SVC #1");
+    periodicThread *p;
+    if (tcb[task].periodic == NO_PERIODIC)
+        return;
+    p = &periodics[tcb[task].periodic];
+    if (p->jitterPending)
+    {
+        uint32_t jitter = (DWT_CYCCNT_R - p->releaseCycles) / CYCLES_PER_US;
+        if (jitter < p->jitterMin)
+            p->jitterMin = jitter;
+        if (jitter > p->jitterMax)
+            p->jitterMax = jitter;
+        p->jitterSum += jitter;
+        p->jitterCount++;
+        p->jitterPending = false;
+    }
 }
 
-// REQUIRED: modify this function to support 1ms system timer
-// execution yielded back to scheduler until time elapses using pendsv
-void sleep(uint32_t tick)
+// Clears the timing statistics and releases the first job now
+void resetPeriodicStats(uint8_t task)
 {
-    __asm("  SVC #2");
+    periodicThread *p;
+    tcb[task].absDeadline = systemTicks + tcb[task].relDeadline;
+    tcb[task].releasePending = false;
+    if (tcb[task].periodic != NO_PERIODIC)
+    {
+        p = &periodics[tcb[task].periodic];
+        p->release = systemTicks;
+        p->releaseCycles = DWT_CYCCNT_R;
+        p->jitterPending = true;
+        p->paced = false;
+        p->deadlineMisses = 0;
+        p->jitterMin = 0xFFFFFFFF;
+        p->jitterMax = 0;
+        p->jitterSum = 0;
+        p->jitterCount = 0;
+    }
 }
 
-// REQUIRED: modify this function to lock a mutex using pendsv
-void lock(int8_t mutex)
+// Fills a new stack with STACK_FILL and clears its high-water mark
+void fillStack(uint8_t task)
 {
-    __asm("  SVC #3");
+    uint32_t *p = tcb[task].BaseAddress;
+    uint32_t *top = (uint32_t*)tcb[task].spInit + 1;
+    while (p < top)
+    {
+        *p++ = STACK_FILL;
+    }
+    tcb[task].stackPeak = 0;
+    tcb[task].stackScan = tcb[task].BaseAddress;
 }
 
-// REQUIRED: modify this function to unlock a mutex using pendsv
-void unlock(int8_t mutex)
+// Charges the cycles since the last switch to the running task
+void accountCpuTime(void)
 {
-    __asm("  SVC #4");
+    uint32_t now = DWT_CYCCNT_R;
+    tcb[taskCurrent].cpuTime[cpuActive] += now - lastSwitchCycles;
+    lastSwitchCycles = now;
 }
 
-// REQUIRED: modify this function to wait a semaphore using pendsv
-void wait(int8_t semaphore)
+// Closes the current accounting window: the filled counters become the
+// ones reported and the idle time and load averages are updated
+void rollCpuWindow(void)
 {
-    __asm("  SVC #5");
+    static uint32_t windowStartCycles = 0;
+    uint32_t idleCycles = 0;
+    uint32_t busy;
+    uint8_t i;
+
+    accountCpuTime();
+    cpuWindowCycles = lastSwitchCycles - windowStartCycles;
+    windowStartCycles = lastSwitchCycles;
+    cpuWindowStart = systemTicks;
+
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].state != STATE_INVALID && tcb[i].priority == IDLE_PRIORITY)
+            idleCycles += tcb[i].cpuTime[cpuActive];
+    }
+    cpuActive ^= 1;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        tcb[i].cpuTime[cpuActive] = 0;
+    }
+
+    if (cpuWindowCycles != 0)
+    {
+        cpuIdle = (uint32_t)(((uint64_t)idleCycles * 10000) / cpuWindowCycles);
+        if (cpuIdle > 10000)
+            cpuIdle = 10000;
+        busy = 10000 - cpuIdle;
+        //exponential averages, each moving by window / time constant of the way to the new sample
+        cpuLoad[0] += ((int32_t)busy - cpuLoad[0]) * CPU_WINDOW_MS / LOAD_1S;
+        cpuLoad[1] += ((int32_t)busy - cpuLoad[1]) * CPU_WINDOW_MS / LOAD_5S;
+        cpuLoad[2] += ((int32_t)busy - cpuLoad[2]) * CPU_WINDOW_MS / LOAD_15S;
+    }
 }
 
-// REQUIRED: modify this function to signal a semaphore is available using pendsv
-void post(int8_t semaphore)
+// Moves system time forward and wakes every task whose delay has run out.
+// A deadline thread that paces itself with sleep() instead of
+// waitNextPeriod() starts a new job at its wakeup time, so it still gets a
+// fresh deadline. Once a thread has called waitNextPeriod(), a sleep() in
+// the middle of a job leaves its release and deadline alone.
+void advanceTimers(uint32_t elapsed)
 {
-    __asm("  SVC #6");
+    systemTicks += elapsed;
+    while (timerHead != NO_TASK && tcb[timerHead].ticks <= elapsed)
+    {
+        uint8_t task = timerHead;
+        elapsed -= tcb[task].ticks;
+        tcb[task].ticks = 0;
+        timerRemove(task);
+        if (tcb[task].releasePending)
+        {
+            releaseJob(task, DWT_CYCCNT_R);
+        }
+        else if (tcb[task].timedWait)
+        {
+            expireWait(task);
+        }
+        else if (tcb[task].periodic != NO_PERIODIC && !periodics[tcb[task].periodic].paced)
+        {
+            periodics[tcb[task].periodic].release = systemTicks - elapsed;  //the tick it was due, not the one it is seen on
+            releaseJob(task, DWT_CYCCNT_R);
+        }
+        wakeTask(task);
+    }
+    if (timerHead != NO_TASK)
+    {
+        tcb[timerHead].ticks -= elapsed;
+    }
 }
 
-void* MallocWrapper(uint32_t SizeInBytes)
+// Tickless idle
+// While the idle task is the only READY task nothing can change until the
+// next wakeup, so SysTick is reprogrammed to fire once at that deadline
+// (up to MAX_IDLE_TICKS). As soon as another task becomes READY the long
+// period is cut short on the next tick boundary and the elapsed whole
+// ticks are credited to the wakeup list.
+void updateTickMode(void)
 {
-    __asm("  SVC #7");
+    bool idleOnly = (readyBitmap == (1 << (15 - IDLE_PRIORITY)))
+                 && (readyQueue[IDLE_PRIORITY].head == readyQueue[IDLE_PRIORITY].tail);
+    uint32_t remaining = NVIC_ST_CURRENT_R;         //cycles left in the current SysTick period
+
+    //Leave the period alone when SysTick is about to fire or already pending
+    if ((remaining < 1000) || (NVIC_INT_CTRL_R & NVIC_INT_CTRL_PENDSTSET))
+    {
+        return;
+    }
+
+    if (idleOnly && stretchTicks == 1)
+    {
+        uint32_t ticks = MAX_IDLE_TICKS;
+        if (timerHead != NO_TASK && tcb[timerHead].ticks < ticks)
+        {
+            ticks = tcb[timerHead].ticks;
+        }
+        if (ticks > 1)
+        {
+            //finish the current tick, then run ticks - 1 more whole ticks
+            NVIC_ST_RELOAD_R = remaining + (ticks - 1) * CYCLES_PER_TICK;
+            NVIC_ST_CURRENT_R = 0;
+            stretchTicks = ticks;
+        }
+    }
+    else if (!idleOnly && stretchTicks > 1)
+    {
+        //the stretched period ends on a tick boundary, so count the boundaries still ahead
+        uint32_t ticksAhead = (remaining + CYCLES_PER_TICK - 1) / CYCLES_PER_TICK;
+        uint32_t reload = (remaining - 1) % CYCLES_PER_TICK;
+        NVIC_ST_RELOAD_R = (reload == 0) ? 1 : reload;  //run only up to the next boundary
+        NVIC_ST_CURRENT_R = 0;
+        advanceTimers(stretchTicks - ticksAhead);
+        stretchTicks = 1;
+    }
 }
 
-void* PIDgetter(void)
+// Changes the priority the scheduler uses for a task, moving it between ready
+// queues or to its new place in a priority-ordered wait queue
+void setCurrentPriority(uint8_t task, uint8_t priority)
 {
-    return tcb[taskCurrent].pid;
+    if (tcb[task].currentPriority == priority)
+        return;
+    if (tcb[task].state == STATE_READY)
+    {
+        readyRemove(task);
+        tcb[task].currentPriority = priority;
+        readyInsert(task);
+    }
+    else if (tcb[task].state == STATE_BLOCKED_MUTEX && mutexes[tcb[task].mutex].policy == QUEUE_PRIO)
+    {
+        removeTask(&mutexes[tcb[task].mutex].waiters, task);
+        tcb[task].currentPriority = priority;
+        waitEnqueue(&mutexes[tcb[task].mutex].waiters, QUEUE_PRIO, task);
+    }
+    else if (tcb[task].state == STATE_BLOCKED_SEMAPHORE && semaphores[tcb[task].semaphore].policy == QUEUE_PRIO)
+    {
+        removeTask(&semaphores[tcb[task].semaphore].waiters, task);
+        tcb[task].currentPriority = priority;
+        waitEnqueue(&semaphores[tcb[task].semaphore].waiters, QUEUE_PRIO, task);
+    }
+    else if ((tcb[task].state == STATE_BLOCKED_SEND || tcb[task].state == STATE_BLOCKED_RECEIVE)
+             && queues[tcb[task].queue].policy == QUEUE_PRIO)
+    {
+        removeTask(queueWaiters(task), task);
+        tcb[task].currentPriority = priority;
+        waitEnqueue(queueWaiters(task), QUEUE_PRIO, task);
+    }
+    else
+    {
+        tcb[task].currentPriority = priority;
+    }
 }
 
-void KillThread(void* arg)
+// Priority inheritance
+// A task blocking on a mutex lends its priority to the owner. If the owner
+// is itself blocked on a mutex the boost is passed down the chain.
+void inheritPriority(uint8_t mutex, uint8_t waiter)
 {
-    uint32_t TaskPID = (uint32_t)arg;                       // Get the PID if Kill() is called or from function call
-    char *TaskName = (char*)arg;                  // Get the Name if Pkill() is called
+    uint8_t prio = tcb[waiter].currentPriority;
+    uint8_t owner = mutexes[mutex].lockedBy;
+    uint8_t depth = 0;
 
-    uint8_t task = 0;
-    for(task = 0; task < MAX_TASKS; task++)             // Go through the TCB
+    while (priorityInheritance && (depth++ < MAX_TASKS) && (tcb[owner].currentPriority > prio))
     {
-        if((TaskPID == (uint32_t)tcb[task].pid) || ((cmpStr(tcb[task].name, TaskName)) == 0))
+        setCurrentPriority(owner, prio);
+        if (tcb[owner].state != STATE_BLOCKED_MUTEX || !mutexes[tcb[owner].mutex].lock)
+            break;
+        owner = mutexes[tcb[owner].mutex].lockedBy;
+    }
+}
+
+// Recomputes a task's effective priority from its base priority and the
+// waiters of every mutex it still holds, then lets the change ripple to
+// the owner of the mutex the task is blocked on
+void restorePriority(uint8_t task)
+{
+    uint8_t depth = 0;
+    while (depth++ < MAX_TASKS)
+    {
+        uint8_t prio = tcb[task].priority;
+        uint8_t m, waiter;
+        if (priorityInheritance)
         {
-            if(tcb[task].state != STATE_STOPPED)
+            for (m = 0; m < MAX_MUTEXES; m++)
             {
-                freeToHeap(tcb[task].BaseAddress);          // Use the thread's base address from the tcb to free it
-                freeToHeap(tcb[task].Allocation);           // For function allocations
-
-                if(tcb[task].state == STATE_BLOCKED_MUTEX)                          // Check if the task is in a Blocked_by_Mutex state and remove it
+                if (mutexes[m].lock && mutexes[m].lockedBy == task)
                 {
-                    uint8_t i,j = 0;
-                    for (i = 0; i < mutexes[tcb[task].mutex].queueSize; i++)        // Go through the process queue and check for the task
+                    for (waiter = mutexes[m].waiters.head; waiter != NO_TASK; waiter = tcb[waiter].next)
                     {
-                        if (mutexes[tcb[task].mutex].processQueue[i] == task)       // If task found, just update the queue
-                        {
-                            break;
-                        }
+                        if (tcb[waiter].currentPriority < prio)
+                            prio = tcb[waiter].currentPriority;
                     }
-
-                    for (j = i; j < mutexes[tcb[task].mutex].queueSize - 1; j++)    // Shift remaining tasks in the queue
+                }
+            }
+        }
+        if (prio == tcb[task].currentPriority)
+            break;
+        setCurrentPriority(task, prio);
+        if (tcb[task].state != STATE_BLOCKED_MUTEX || !mutexes[tcb[task].mutex].lock)
+            break;
+        task = mutexes[tcb[task].mutex].lockedBy;
+    }
+}
+
+// Records how long a task waited for a mutex it has just been handed
+void recordMutexWait(uint8_t mutex, uint8_t task)
+{
+    uint32_t waited = systemTicks - tcb[task].blockedAt;
+    if (waited >= mutexes[mutex].maxBlocked)
+    {
+        mutexes[mutex].maxBlocked = waited;
+        mutexes[mutex].maxBlockedTask = task;
+    }
+}
+
+// policy selects the order waiters are woken in: QUEUE_FIFO or QUEUE_PRIO
+bool initMutex(uint8_t mutex, uint8_t policy)
+{
+    bool ok = (mutex < MAX_MUTEXES);
+    if (ok)
+    {
+        mutexes[mutex].lock = false;
+        mutexes[mutex].lockedBy = 0;
+        mutexes[mutex].queueSize = 0;
+        mutexes[mutex].policy = policy;
+        initTaskList(&mutexes[mutex].waiters);
+        mutexes[mutex].maxBlocked = 0;
+        mutexes[mutex].maxBlockedTask = 0;
+    }
+    return ok;
+}
+
+bool initSemaphore(uint8_t semaphore, uint8_t count, uint8_t policy)
+{
+    bool ok = (semaphore < MAX_SEMAPHORES);
+    if (ok)
+    {
+        semaphores[semaphore].count = count;
+        semaphores[semaphore].queueSize = 0;
+        semaphores[semaphore].policy = policy;
+        initTaskList(&semaphores[semaphore].waiters);
+    }
+    return ok;
+}
+
+// depth messages of msgSize bytes (sizeof(msgBuffer) for QUEUE_ZERO_COPY);
+// policy selects the order blocked senders and receivers are woken in
+bool initQueue(uint8_t queue, uint8_t depth, uint8_t msgSize, uint8_t mode, uint8_t policy)
+{
+    bool ok = (queue < MAX_QUEUES) && (depth > 0) && (depth <= MAX_QUEUE_DEPTH) && (msgSize <= MAX_MSG_SIZE);
+    if (ok)
+    {
+        queues[queue].depth = depth;
+        queues[queue].msgSize = (mode == QUEUE_ZERO_COPY) ? sizeof(msgBuffer) : msgSize;
+        queues[queue].mode = mode;
+        queues[queue].policy = policy;
+        queues[queue].head = 0;
+        queues[queue].count = 0;
+        queues[queue].maxCount = 0;
+        initTaskList(&queues[queue].senders);
+        initTaskList(&queues[queue].receivers);
+    }
+    return ok;
+}
+
+// Message queues
+// A message goes straight to a blocked receiver when there is one, and a
+// slot freed by a receive is refilled from the first blocked sender, so a
+// task never wakes to find its message still pending.
+
+void copyMessage(uint8_t *dst, const uint8_t *src, uint8_t size)
+{
+    while (size--)
+    {
+        *dst++ = *src++;
+    }
+}
+
+// Address of the n-th message from the oldest one
+uint8_t* queueSlot(msgQueue *q, uint8_t n)
+{
+    return &q->data[((q->head + n) % q->depth) * q->msgSize];
+}
+
+// True if a task has MPU access to all of a heap buffer
+bool ownsBuffer(uint8_t task, const msgBuffer *buf)
+{
+    if (!isHeapMemory(buf->data, buf->size))
+        return false;
+    return (tcb[task].srd & sramWindowMask(buf->data, buf->size)) == 0;
+}
+
+// Service call handlers run with kernel rights, so every buffer a task
+// passes in is checked first: the task must be able to write it itself
+// (its stack or a heap buffer it owns), or, for memory the kernel only
+// reads, it may also be in flash.
+bool callerCanWrite(const void *p, uint32_t size)
+{
+    msgBuffer buf = {(void*)p, size};
+    return ownsBuffer(taskCurrent, &buf);
+}
+
+bool callerCanRead(const void *p, uint32_t size)
+{
+    bool inFlash = (size != 0) && (size <= FLASH_END) && ((uint32_t)p <= FLASH_END - size);
+    return inFlash || callerCanWrite(p, size);
+}
+
+// Grants or revokes a task's access to a heap buffer (nothing for NO_TASK,
+// which stands for an ISR). A pool block passes to the task it is granted
+// to, and to no one while it waits in a queue. Any other buffer granted is
+// recorded in the task's tcb, so it can be freed if the task is killed.
+void setBufferAccess(uint8_t task, const msgBuffer *buf, bool allow)
+{
+    uint8_t i;
+    bool pooled = false;
+    if (task == NO_TASK)
+        return;
+    for (i = 0; i < MAX_POOLS; i++)
+    {
+        pooled |= setBlockOwner(&pools[i], buf->data, allow ? task : NO_TASK);
+    }
+    if (allow)
+    {
+        addSramAccessWindow(&tcb[task].srd, buf->data, buf->size);
+        if (!pooled)
+            tcb[task].received = buf->data;
+    }
+    else
+    {
+        removeSramAccessWindow(&tcb[task].srd, buf->data, buf->size);
+        if (tcb[task].Allocation == buf->data)
+            tcb[task].Allocation = 0;           //no longer freed when the task is killed
+        if (tcb[task].received == buf->data)
+            tcb[task].received = 0;
+    }
+    buildSramRegions(tcb[task].sramAttr, tcb[task].srd);
+    if (task == taskCurrent)
+        applySramRegions(sramRegionBase, tcb[task].sramAttr);
+}
+
+// Adds a message to a queue on behalf of a sender (NO_TASK for an ISR).
+// Returns false if the queue is full.
+bool putMessage(uint8_t queue, const void *msg, uint8_t sender)
+{
+    msgQueue *q = &queues[queue];
+    uint8_t receiver;
+    if (q->count == q->depth)
+        return false;
+    if (q->mode == QUEUE_ZERO_COPY)
+        setBufferAccess(sender, msg, false);
+
+    receiver = waitDequeue(&q->receivers);          //only waiting while the queue is empty
+    if (receiver != NO_TASK)
+    {
+        copyMessage(tcb[receiver].msg, msg, q->msgSize);
+        if (q->mode == QUEUE_ZERO_COPY)
+            setBufferAccess(receiver, msg, true);
+        wakeTask(receiver);
+    }
+    else
+    {
+        copyMessage(queueSlot(q, q->count), msg, q->msgSize);
+        q->count++;
+        if (q->count > q->maxCount)
+            q->maxCount = q->count;
+    }
+    return true;
+}
+
+// Takes the oldest message out of a queue for a receiver. Returns false if
+// the queue is empty.
+bool getMessage(uint8_t queue, void *msg, uint8_t receiver)
+{
+    msgQueue *q = &queues[queue];
+    uint8_t sender;
+    if (q->count == 0)
+        return false;
+    copyMessage(msg, queueSlot(q, 0), q->msgSize);
+    if (q->mode == QUEUE_ZERO_COPY)
+        setBufferAccess(receiver, msg, true);
+    q->head = (q->head + 1) % q->depth;
+    q->count--;
+
+    sender = waitDequeue(&q->senders);              //only waiting while the queue is full
+    if (sender != NO_TASK)
+    {
+        if (q->mode == QUEUE_ZERO_COPY)
+            setBufferAccess(sender, tcb[sender].msg, false);
+        copyMessage(queueSlot(q, q->count), tcb[sender].msg, q->msgSize);
+        q->count++;
+        wakeTask(sender);
+    }
+    return true;
+}
+
+bool initEventGroup(uint8_t group)
+{
+    bool ok = (group < MAX_EVENT_GROUPS);
+    if (ok)
+    {
+        eventGroups[group].used = true;
+        eventGroups[group].flags = 0;
+        initTaskList(&eventGroups[group].waiters);
+    }
+    return ok;
+}
+
+// Creates a pool of blocks blocks of blockSize bytes from the heap, at most
+// MAX_POOL_BLOCKS. Call it before startRtos(), like initQueue().
+bool initPool(uint8_t pool, uint16_t blockSize, uint16_t blocks)
+{
+    return (pool < MAX_POOLS) && (pools[pool].base == 0) && createBlockPool(&pools[pool], blockSize, blocks);
+}
+
+// Event flags
+// Waiters are kept in arrival order and every one of them is checked when
+// flags are set, so a single set can wake several tasks at once.
+
+// Returns the flags that satisfy a wait, or 0 if it has to go on waiting
+uint32_t eventsMatched(uint32_t flags, uint32_t mask, uint8_t options)
+{
+    uint32_t matched = flags & mask;
+    if ((options & EVENT_WAIT_ALL) ? (matched != mask) : (matched == 0))
+        return 0;
+    return matched;
+}
+
+// Sets flags and wakes every waiter whose condition now holds. The bits
+// those waiters asked to clear are only cleared after all of them have
+// been checked, so they see the same flags. Returns the flags left set.
+uint32_t raiseEvents(uint8_t group, uint32_t flags)
+{
+    eventGroup *g = &eventGroups[group];
+    uint32_t clear = 0;
+    uint32_t matched;
+    uint8_t task = g->waiters.head;
+    uint8_t next;
+
+    g->flags |= flags;
+    while (task != NO_TASK)
+    {
+        next = tcb[task].next;                      //wakeTask() relinks the task
+        matched = eventsMatched(g->flags, tcb[task].eventMask, tcb[task].eventOptions);
+        if (matched != 0)
+        {
+            removeTask(&g->waiters, task);
+            if (tcb[task].eventOptions & EVENT_CLEAR)
+                clear |= matched;
+            setSyscallResult(task, matched);
+            wakeTask(task);
+        }
+        task = next;
+    }
+    g->flags &= ~clear;
+    return g->flags;
+}
+
+// Task notifications
+// Every task has a notification word it can wait on by itself, so a
+// notification needs no kernel object or wait queue: the notifier updates
+// the target's word and wakes it straight from its tcb.
+
+// Takes a non-zero notification word: returns it and clears or decrements it
+uint32_t takeNotification(uint8_t task, bool clear)
+{
+    uint32_t value = tcb[task].notifyValue;
+    tcb[task].notifyValue = clear ? 0 : value - 1;
+    return value;
+}
+
+// Applies a NOTIFY_ action to a task's word and wakes the task if it is
+// waiting in notifyTake(). Returns false if there is no such task.
+bool sendNotification(_fn fn, uint8_t action, uint32_t value)
+{
+    uint8_t task = 0;
+    while (task < MAX_TASKS && (tcb[task].pid != fn || tcb[task].state == STATE_INVALID))
+    {
+        task++;
+    }
+    if (task == MAX_TASKS || tcb[task].state == STATE_STOPPED)
+        return false;
+
+    if (action == NOTIFY_GIVE)
+        tcb[task].notifyValue++;
+    else if (action == NOTIFY_SET_BITS)
+        tcb[task].notifyValue |= value;
+    else
+        tcb[task].notifyValue = value;
+
+    if (tcb[task].state == STATE_BLOCKED_NOTIFY && tcb[task].notifyValue != 0)
+    {
+        setSyscallResult(task, takeNotification(task, tcb[task].notifyClear));
+        wakeTask(task);
+    }
+    return true;
+}
+
+// REQUIRED: initialize systick for 1ms system timer
+void initRtos(void)
+{
+    uint8_t i;
+    // no tasks running
+    taskCount = 0;
+    // clear out tcb records
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        tcb[i].state = STATE_INVALID;
+        tcb[i].pid = 0;
+    }
+    // empty ready queues
+    for (i = 0; i < NUM_PRIORITIES; i++)
+    {
+        initTaskList(&readyQueue[i]);
+    }
+    readyBitmap = 0;
+    timerHead = NO_TASK;
+    for (i = 0; i < MAX_QUEUES; i++)
+    {
+        queues[i].depth = 0;
+    }
+    for (i = 0; i < MAX_EVENT_GROUPS; i++)
+    {
+        eventGroups[i].used = false;
+    }
+    for (i = 0; i < MAX_POOLS; i++)
+    {
+        pools[i].base = 0;
+    }
+    for (i = 0; i < MAX_PERIODIC; i++)
+    {
+        periodics[i].period = 0;
+    }
+
+    // free-running cycle counter for timestamps
+    NVIC_DBG_INT_R |= NVIC_DBG_INT_TRCENA;
+    DWT_CYCCNT_R = 0;
+    DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;
+
+    // FPU for privileged and unprivileged code, with lazy stacking: an
+    // exception only reserves room for S0-S15 and they are written out the
+    // first time the handler (pushREGS) touches the FPU
+    NVIC_CPAC_R |= NVIC_CPAC_CP10_FULL | NVIC_CPAC_CP11_FULL;
+    NVIC_FPCC_R |= NVIC_FPCC_ASPEN | NVIC_FPCC_LSPEN;
+    __asm("  DSB");
+    __asm("  ISB");
+
+    NVIC_ST_RELOAD_R = SYSTICK_RELOAD_1MS;      //40Mhz system clock @ 1 Khz = 40,000 - 1
+    NVIC_ST_CTRL_R |= NVIC_ST_CTRL_CLK_SRC | NVIC_ST_CTRL_INTEN | NVIC_ST_CTRL_ENABLE;  //Enables Systick Timer and interrupt generation
+}
+
+// REQUIRED: Implement prioritization to NUM_PRIORITIES
+// The highest non-empty priority level comes from a CLZ of the ready bitmap.
+// The task at the head of that level is dispatched and rotated to the tail
+// so tasks sharing a priority level are served round-robin.
+// In EDF mode the READY task with the earliest absolute deadline runs; tasks
+// without a deadline only get the CPU, by priority, when no deadline task is READY.
+uint8_t rtosScheduler(void)
+{
+    bool ok;
+    static uint8_t task = 0xFF;
+    ok = false;
+
+    if(schedulerMode == SCHED_EDF)
+    {
+        uint8_t i = 0;
+        uint8_t earliest = NO_TASK;
+        for (i = 0; i < MAX_TASKS; i++)
+        {
+            if (tcb[i].state == STATE_READY && tcb[i].relDeadline != 0)
+            {
+                //signed difference keeps the comparison valid across systemTicks wrap-around
+                if (earliest == NO_TASK || (int32_t)(tcb[i].absDeadline - tcb[earliest].absDeadline) < 0)
+                {
+                    earliest = i;
+                }
+            }
+        }
+        if (earliest != NO_TASK)
+        {
+            task = earliest;
+            return task;
+        }
+    }
+
+    if(schedulerMode != SCHED_RR)
+    {
+        if (readyBitmap != 0)
+        {
+            uint8_t prio = countLeadingZeros(readyBitmap) - 16;
+            taskList *level = &readyQueue[prio];
+
+            task = level->head;
+            if (level->head != level->tail)     //Rotate the level when there are multiple tasks
+            {
+                removeTask(level, task);
+                insertTaskTail(level, task);
+            }
+        }
+        return task;
+    }
+    else                //run as round-robin
+    {
+        while (!ok)
+        {
+            task++;
+            if (task >= MAX_TASKS)
+                task = 0;
+            ok = (tcb[task].state == STATE_READY);
+        }
+        return task;
+    }
+   // return 0xFF;
+}
+
+// REQUIRED: modify this function to start the operating system
+// by calling scheduler, set srd bits, setting PSP, ASP bit, call fn with fn add in R0
+// fn set TMPL bit, and PC <= fn
+void startRtos(void)
+{
+    // Kernel handlers at the least urgent priority, below every device interrupt
+    NVIC_SYS_PRI2_R = (NVIC_SYS_PRI2_R & ~NVIC_SYS_PRI2_SVC_M) | (KERNEL_PRIORITY << NVIC_SYS_PRI2_SVC_S);
+    NVIC_SYS_PRI3_R = (NVIC_SYS_PRI3_R & ~(NVIC_SYS_PRI3_TICK_M | NVIC_SYS_PRI3_PENDSV_M))
+                    | (KERNEL_PRIORITY << NVIC_SYS_PRI3_TICK_S) | (KERNEL_PRIORITY << NVIC_SYS_PRI3_PENDSV_S);
+
+    setPSP((uint32_t*)0x20008000);
+    setASP();
+    setTMPL();
+    SYSCALL(SVC_LAUNCH);
+}
+
+// REQUIRED:
+// add task if room in task list
+// store the thread name
+// allocate stack space and store top of stack in sp and spInit
+// set the srd bits based on the memory allocation
+// initialize the created stack to make it appear the thread has run before
+bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes)
+{
+    bool ok = false;
+    uint8_t i = 0;
+    bool found = false;
+    if (taskCount < MAX_TASKS)
+    {
+        // make sure fn not already in list (prevent reentrancy)
+        while (!found && (i < MAX_TASKS))
+        {
+            found = (tcb[i++].pid ==  fn);
+        }
+        uint32_t* InitialAlloc = 0;
+        if (!found)
+        {
+            InitialAlloc = mallocFromHeap(stackBytes);
+        }
+        if (InitialAlloc != 0)          // no thread without a stack
+        {
+            // find first available tcb record
+            i = 0;
+
+            uint32_t* p = (uint32_t*)((uint32_t)InitialAlloc + RoundUp(stackBytes) - 4);
+
+
+            while (tcb[i].state != STATE_INVALID) {i++;}
+            tcb[i].pid = fn;
+            tcb[i].sp = (void*)p;  //sets current sp to top of the stack
+            tcb[i].spInit = tcb[i].sp;       //initialize sp
+            tcb[i].priority = priority;
+            tcb[i].currentPriority = priority;
+
+            StringCopy((char*)name, tcb[i].name);
+            uint64_t srdbits = createNoSramAccessMask();
+            addSramAccessWindow(&srdbits, InitialAlloc, stackBytes);   //check srd bits
+            tcb[i].srd = srdbits;
+            buildSramRegions(tcb[i].sramAttr, srdbits);
+
+            tcb[i].BaseAddress = InitialAlloc;
+            tcb[i].ThreadSize = stackBytes;
+            fillStack(i);
+
+            //Hardware push pop
+            *(--p) = 0x01000000;     // xPSR (valid bit)
+            *(--p) = (uint32_t)tcb[i].pid;     // PC
+            *(--p) = 0x00000001;     // LR trash value doesn't matter
+            *(--p) = 0x12121212;     // R12
+            *(--p) = 0x03030303;     // R3
+            *(--p) = 0x02020202;     // R2
+            *(--p) = 0x01010101;     // R1
+            *(--p) = 0x0000001A;     // R0
+            //Software push pop
+            *(--p) = 0xDEAD0011;     // R11
+            *(--p) = 0xDEAD0010;     // R10
+            *(--p) = 0xDEAD0009;     // R9
+            *(--p) = 0xDEAD0008;     // R8
+            *(--p) = 0xDEAD0007;     // R7
+            *(--p) = 0xDEAD0006;     // R6
+            *(--p) = 0xDEAD0005;     // R5
+            *(--p) = 0xDEAD0004;     // R4
+            *(--p) = EXC_RETURN_THREAD_PSP;    // EXC_RETURN Value
+
+            tcb[i].sp = p;
+
+            tcb[i].state = STATE_READY;
+            readyInsert(i);
+
+            tcb[i].periodic = NO_PERIODIC;
+            tcb[i].relDeadline = 0;
+            resetPeriodicStats(i);
+            tcb[i].cpuTime[0] = 0;
+            tcb[i].cpuTime[1] = 0;
+            tcb[i].fpuUsed = false;
+            tcb[i].timedWait = false;
+            tcb[i].notifyValue = 0;
+
+            // increment task count
+            taskCount++;
+            ok = true;
+        }
+    }
+    return ok;
+}
+
+// Creates a thread that runs under a period and a relative deadline.
+// A deadline of 0 means the deadline equals the period. The first job is
+// released now; the thread calls waitNextPeriod() at the end of each job.
+// Fails once MAX_PERIODIC periodic threads have been created.
+bool createPeriodicThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes,
+                          uint32_t periodMs, uint32_t deadlineMs)
+{
+    bool ok = false;
+    uint8_t i = 0;
+    uint8_t slot = 0;
+    while (slot < MAX_PERIODIC && periodics[slot].period != 0) {slot++;}
+    if (slot < MAX_PERIODIC && periodMs != 0)
+    {
+        ok = createThread(fn, name, priority, stackBytes);
+    }
+    if (ok)
+    {
+        while (tcb[i].pid != fn) {i++;}
+        periodics[slot].period = periodMs;
+        tcb[i].periodic = slot;
+        tcb[i].relDeadline = (deadlineMs != 0) ? deadlineMs : periodMs;
+        resetPeriodicStats(i);
+    }
+    return ok;
+}
+
+// REQUIRED: modify this function to restart a thread
+// fn may also be the thread's name
+void restartThread(_fn fn)
+{
+    SYSCALL(SVC_RESTART_THREAD);
+}
+
+// REQUIRED: modify this function to stop a thread
+// REQUIRED: remove any pending semaphore waiting, unlock any mutexes
+void stopThread(_fn fn)
+{
+    SYSCALL(SVC_STOP_THREAD);
+}
+
+// REQUIRED: modify this function to set a thread priority
+void setThreadPriority(_fn fn, uint8_t priority)
+{
+    SYSCALL(SVC_SET_PRIORITY);
+}
+
+// REQUIRED: modify this function to yield execution back to scheduler using pendsv
+void yield(void)
+{
+    SYSCALL(SVC_YIELD);
+}
+
+// REQUIRED: modify this function to support 1ms system timer
+// execution yielded back to scheduler until time elapses using pendsv
+void sleep(uint32_t tick)
+{
+    SYSCALL(SVC_SLEEP);
+}
+
+// Ends the current job of a periodic thread and sleeps until the next
+// release, which is always one period after the previous one so the
+// schedule does not drift with execution time
+void waitNextPeriod(void)
+{
+    SYSCALL(SVC_WAIT_NEXT_PERIOD);
+}
+
+// REQUIRED: modify this function to lock a mutex using pendsv
+void lock(int8_t mutex)
+{
+    SYSCALL(SVC_LOCK);
+}
+
+// REQUIRED: modify this function to unlock a mutex using pendsv
+void unlock(int8_t mutex)
+{
+    SYSCALL(SVC_UNLOCK);
+}
+
+// REQUIRED: modify this function to wait a semaphore using pendsv
+void wait(int8_t semaphore)
+{
+    SYSCALL(SVC_WAIT);
+}
+
+// REQUIRED: modify this function to signal a semaphore is available using pendsv
+void post(int8_t semaphore)
+{
+    SYSCALL(SVC_POST);
+}
+
+uint32_t svcPost(uint8_t sema);
+
+// Same as post() for interrupt handlers
+void postFromIsr(uint8_t semaphore)
+{
+    uint32_t state;
+    if (semaphore >= MAX_SEMAPHORES)
+        return;
+    state = enterCritical();
+    svcPost(semaphore);
+    leaveCritical(state);
+}
+
+// Sends from an interrupt handler without blocking. Returns false if the
+// queue is full. Like every FromIsr function, it may only be called from
+// handlers at MAX_SYSCALL_PRIORITY or less urgent.
+bool queueSendFromIsr(uint8_t queue, const void *msg)
+{
+    uint32_t state = enterCritical();
+    bool ok = (queue < MAX_QUEUES) && (queues[queue].depth != 0) && putMessage(queue, msg, NO_TASK);
+    leaveCritical(state);
+    return ok;
+}
+
+// Same as setEventFlags() for interrupt handlers
+uint32_t setEventFlagsFromIsr(uint8_t group, uint32_t flags)
+{
+    uint32_t state;
+    if (group >= MAX_EVENT_GROUPS || !eventGroups[group].used)
+        return 0;
+    state = enterCritical();
+    flags = raiseEvents(group, flags);
+    leaveCritical(state);
+    return flags;
+}
+
+void clearEventFlags(uint8_t group, uint32_t flags)
+{
+    SYSCALL(SVC_CLEAR_EVENTS);
+}
+
+// Same as notify() for interrupt handlers
+bool notifyFromIsr(_fn fn, uint8_t action, uint32_t value)
+{
+    uint32_t state = enterCritical();
+    bool ok = sendNotification(fn, action, value);
+    leaveCritical(state);
+    return ok;
+}
+
+// Kernel critical sections
+// Masks the interrupts allowed to call the FromIsr functions and returns
+// the previous mask for leaveCritical(), so sections nest. Kernel handlers
+// run inside one; interrupts more urgent than MAX_SYSCALL_PRIORITY are
+// never held off.
+uint32_t enterCritical(void)
+{
+    return raiseBasePri(KERNEL_BASEPRI);
+}
+
+void leaveCritical(uint32_t state)
+{
+    setBasePri(state);
+}
+
+// Frees a buffer from MallocWrapper(), including one received through a
+// zero-copy queue
+void FreeWrapper(void *p)
+{
+    SYSCALL(SVC_FREE);
+}
+
+// Same as poolGet() and poolPut() for interrupt handlers
+void *poolGetFromIsr(uint8_t pool)
+{
+    void *block = 0;
+    uint32_t state;
+    if (pool < MAX_POOLS)
+    {
+        state = enterCritical();
+        block = getBlock(&pools[pool], NO_TASK);
+        leaveCritical(state);
+    }
+    return block;
+}
+
+bool poolPutFromIsr(uint8_t pool, void *block)
+{
+    bool ok = false;
+    uint32_t state;
+    if (pool < MAX_POOLS)
+    {
+        state = enterCritical();
+        ok = putBlock(&pools[pool], block, NO_TASK);
+        leaveCritical(state);
+    }
+    return ok;
+}
+
+void setSchedulerMode(uint8_t mode)
+{
+    SYSCALL(SVC_SCHED);
+}
+
+void setPreemption(bool on)
+{
+    SYSCALL(SVC_PREEMPT);
+}
+
+void setPriorityInheritance(bool on)
+{
+    SYSCALL(SVC_PI);
+}
+
+void reboot(void)
+{
+    SYSCALL(SVC_REBOOT);
+}
+
+// Copies the mutex and semaphore state into the caller's buffer for ipcs
+void getMutexSemaInfo(ExtractMutexSema *info)
+{
+    SYSCALL(SVC_MUTEX_SEMA_INFO);
+}
+
+// Copies the message queue state into the caller's buffer for ipcs
+void getQueueInfo(ExtractQueue *info)
+{
+    SYSCALL(SVC_QUEUE_INFO);
+}
+
+// Copies the event flag groups into the caller's buffer for ipcs
+void getEventInfo(ExtractEvents *info)
+{
+    SYSCALL(SVC_EVENT_INFO);
+}
+
+// Copies a snapshot of every thread into the caller's buffer for ps, meminfo and stack
+void getTCBinfo(ExtractTCB *info)
+{
+    SYSCALL(SVC_TCB_INFO);
+}
+
+// Copies the idle time and load averages of the last window for ps
+void getCpuInfo(ExtractCpu *info)
+{
+    SYSCALL(SVC_CPU_INFO);
+}
+
+void getHeapInfo(heapStats *info)
+{
+    SYSCALL(SVC_HEAP_INFO);
+}
+
+// Called by the idle task to advance the stack high-water scan
+void scanStacks(void)
+{
+    SYSCALL(SVC_STACK_SCAN);
+}
+
+void* PIDgetter(void)
+{
+    return tcb[taskCurrent].pid;
+}
+
+void KillThread(void* arg)
+{
+    uint32_t TaskPID = (uint32_t)arg;                       // Get the PID if Kill() is called or from function call
+    char *TaskName = (char*)arg;                  // Get the Name if Pkill() is called
+    uint32_t state = enterCritical();                       // Also called from the MPU fault handler
+
+    uint8_t task = 0;
+    uint8_t i = 0;
+    for(task = 0; task < MAX_TASKS; task++)             // Go through the TCB
+    {
+        if((TaskPID == (uint32_t)tcb[task].pid) || ((cmpStr(tcb[task].name, TaskName)) == 0))
+        {
+            if(tcb[task].state != STATE_STOPPED)
+            {
+                freeToHeap(tcb[task].BaseAddress);          // Use the thread's base address from the tcb to free it
+                freeToHeap(tcb[task].Allocation);           // For function allocations
+                freeToHeap(tcb[task].received);             // And a zero-copy buffer it was handed
+                tcb[task].Allocation = 0;
+                tcb[task].received = 0;
+                for(i = 0; i < MAX_POOLS; i++)
+                {
+                    putOwnedBlocks(&pools[i], task);        // And the pool blocks it holds
+                }
+
+                if(tcb[task].state == STATE_BLOCKED_MUTEX)                          // Check if the task is in a Blocked_by_Mutex state and remove it
+                {
+                    removeTask(&mutexes[tcb[task].mutex].waiters, task);           // Unlink it from the wait queue
+                    mutexes[tcb[task].mutex].queueSize--;
+                    if(tcb[task].timedWait)
                     {
-                        mutexes[tcb[task].mutex].processQueue[j] = mutexes[tcb[task].mutex].processQueue[j + 1];
+                        timerRemove(task);                                          // and from the wakeup list
                     }
-                    mutexes[tcb[task].mutex].queueSize--;
+                    restorePriority(mutexes[tcb[task].mutex].lockedBy);   // Owner no longer inherits from this task
+                }
+
+                else if(tcb[task].state == STATE_BLOCKED_SEMAPHORE)                 // Or check if the task is in a Blocked_by_semaphore state
+                {
+                    removeTask(&semaphores[tcb[task].semaphore].waiters, task);    // A dead waiter takes nothing from the count
+                    semaphores[tcb[task].semaphore].queueSize--;
+                    if(tcb[task].timedWait)
+                    {
+                        timerRemove(task);
+                    }
+                }
+
+                else if(tcb[task].state == STATE_BLOCKED_NOTIFY && tcb[task].timedWait)
+                {
+                    timerRemove(task);
+                }
+
+                else if(tcb[task].state == STATE_BLOCKED_EVENT)
+                {
+                    removeTask(&eventGroups[tcb[task].eventGroup].waiters, task);
+                    if(tcb[task].timedWait)
+                    {
+                        timerRemove(task);
+                    }
+                }
+
+                else if(tcb[task].state == STATE_BLOCKED_SEND || tcb[task].state == STATE_BLOCKED_RECEIVE)
+                {
+                    removeTask(queueWaiters(task), task);                          // Its message never entered the queue
+                    if(tcb[task].timedWait)
+                    {
+                        timerRemove(task);
+                    }
+                }
+
+                if(mutexes[tcb[task].mutex].lock && mutexes[tcb[task].mutex].lockedBy == task)   // Also check if the task is locking a resource
+                {
+                    mutexes[tcb[task].mutex].lock = false;          // Make the lock as false
+                    //Implement unlock logic
+                    uint8_t nextProcess = waitDequeue(&mutexes[tcb[task].mutex].waiters);   //gets the next process in queue
+                    if(nextProcess != NO_TASK)
+                    {
+                        wakeTask(nextProcess);                                  //set that process as ready
+                        mutexes[tcb[task].mutex].queueSize--;
+                        mutexes[tcb[task].mutex].lock = true;
+                        mutexes[tcb[task].mutex].lockedBy = nextProcess;
+                        recordMutexWait(tcb[task].mutex, nextProcess);
+                        restorePriority(nextProcess);               // New owner inherits from the remaining waiters
+                        if(outranksCurrent(nextProcess))
+                        {
+                            NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+                        }
+                    }
+                }
+                putsUart0(tcb[task].name);
+                putsUart0(" killed. \n");
+                if(tcb[task].state == STATE_READY)
+                {
+                    readyRemove(task);                      // Take it out of the ready queue
                 }
+                else if(tcb[task].state == STATE_DELAYED)
+                {
+                    timerRemove(task);                      // Or out of the wakeup list
+                }
+                tcb[task].timedWait = false;
+                tcb[task].srd = 0xFFFFFFFFFF;               // Change the SRD bits to 1's so that the process cannot R/W
+                buildSramRegions(tcb[task].sramAttr, tcb[task].srd);
+                tcb[task].state = STATE_STOPPED;            // Set state to STOPPED
+                break;
+            }
+            else if (tcb[task].state == STATE_STOPPED)
+            {
+                putsUart0("Process has already been killed. \n");
+            }
+        }
+    }
+    leaveCritical(state);
+}
+
+// REQUIRED: modify this function to add support for the system timer
+// REQUIRED: in preemptive code, add code to request task switch
+// Only the head of the wakeup list is examined. After a tickless idle
+// period the normal 1 ms period is restored (the reload is forced, so the
+// next tick lands late by the ISR entry latency).
+void systickIsr(void)
+{
+    uint32_t state = enterCritical();
+    uint32_t elapsed = stretchTicks;
+    if (NVIC_ST_RELOAD_R != SYSTICK_RELOAD_1MS)
+    {
+        NVIC_ST_RELOAD_R = SYSTICK_RELOAD_1MS;
+        NVIC_ST_CURRENT_R = 0;
+        stretchTicks = 1;
+    }
+
+    advanceTimers(elapsed);
+
+    if (systemTicks - cpuWindowStart >= CPU_WINDOW_MS)
+    {
+        rollCpuWindow();
+    }
+
+    if(preemption == true)
+    {
+        NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+    }
+    leaveCritical(state);
+}
+
+
+// REQUIRED: in coop and preemptive, modify this function to add support for task switching
+// REQUIRED: process UNRUN and READY tasks differently
+// The PendSV exception runs at the lowest priority level for context switching when needed.
+// This is needed when the OS code in the SysTick handler needs to carry out a context switch but has detected that the processor is servicing another interrupt.
+__attribute__((naked))void pendSvIsr(void)
+{
+    __asm("  MOV R12, LR ");                //EXC_RETURN for pushREGS
+    pushREGS();                             //save registers (before C code can touch R12)
+    setBasePri(KERNEL_BASEPRI);             //critical section (no locals here, and PendSV only preempts threads)
+    tcb[taskCurrent].sp = (void*)getPSP();  //save psp
+    if(!(*(uint32_t*)tcb[taskCurrent].sp & EXC_RETURN_NO_FPU))
+    {
+        tcb[taskCurrent].fpuUsed = true;
+    }
+    accountCpuTime();                       //charge the outgoing task
+    updateTickMode();                       //enter or leave tickless idle
+    NVIC_INT_CTRL_R = NVIC_INT_CTRL_UNPEND_SV; //wakeups so far are seen by this pass
+    taskCurrent = rtosScheduler();          //call scheduler
+    recordDispatch(taskCurrent);            //release jitter of periodic tasks
+
+    setPSP(tcb[taskCurrent].sp);            //restore PSP
+    applySramRegions(sramRegionBase, tcb[taskCurrent].sramAttr); //restore SRD
+    setBasePri(0);
+    popREGS();                              //restore regs
+}
+
+// Service call handlers
+// Each handler takes its arguments in the order the wrapper received them
+// (stacked R0-R3) and returns the value the wrapper hands back in R0.
+
+uint32_t svcLaunch(void)
+{
+    taskCurrent = rtosScheduler();
+    lastSwitchCycles = DWT_CYCCNT_R;           //start CPU accounting
+    applySramRegions(sramRegionBase, tcb[taskCurrent].sramAttr); //restore SRD mask
+    setPSP(tcb[taskCurrent].sp);               //restore PSP
+    setBasePri(0);              //popREGS() never returns to svCallIsr() to end its critical section
+    popREGS();                  //restore registers and return into the first task
+    return 0;
+}
+
+uint32_t svcYield(void)
+{
+    NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;   //Calls PendSV
+    return 0;
+}
+
+uint32_t svcSleep(uint32_t ticks)
+{
+    readyRemove(taskCurrent);                   //takes the current task off the ready queue
+    tcb[taskCurrent].state = STATE_DELAYED;     //changes the state of the current task to DELAYED
+    timerInsert(taskCurrent, ticks);            //Queues the task in the wakeup list
+    NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;   //Calls the PendSV for context switching
+    return 0;
+}
+
+//Lock - check if same task is locked or not
+// A task that blocks with a timeout also sits in the wakeup list; the
+// call returns true, unless the timer expires first and expireWait()
+// replaces the result.
+uint32_t svcLockTimeout(uint8_t mutex, uint32_t timeout)
+{
+    if(mutex >= MAX_MUTEXES)
+    {
+        return false;
+    }
+    if(mutexes[mutex].lock == false)            //if mutex index is not locked
+    {
+        mutexes[mutex].lock = true;             //lock it
+        mutexes[mutex].lockedBy = taskCurrent;  //indicate the mutex index is locked by the current task
+        tcb[taskCurrent].mutex = mutex;         //store the mutex index in the TCB
+    }
+    else if(mutexes[mutex].lockedBy != taskCurrent)
+    {
+        if(timeout == 0)
+        {
+            return false;                       //only trying, do not block
+        }
+        readyRemove(taskCurrent);
+        tcb[taskCurrent].state = STATE_BLOCKED_MUTEX;
+        waitEnqueue(&mutexes[mutex].waiters, mutexes[mutex].policy, taskCurrent);    //marking that a thread is blocked by adding it to the wait queue
+        mutexes[mutex].queueSize++;
+        tcb[taskCurrent].mutex = mutex;         //store the mutex index in the TCB
+        tcb[taskCurrent].blockedAt = systemTicks;
+        if(timeout != WAIT_FOREVER)
+        {
+            timerInsert(taskCurrent, timeout);  //wake without the mutex if it is not handed over in time
+            tcb[taskCurrent].timedWait = true;
+        }
+        inheritPriority(mutex, taskCurrent);    //boost the owner (and whoever it waits on) if pi is on
+        NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+    }
+    else
+    {
+        //Kill that thread
+    }
+    return true;
+}
+
+uint32_t svcLock(uint8_t mutex)
+{
+    svcLockTimeout(mutex, WAIT_FOREVER);
+    return 0;
+}
+
+uint32_t svcUnlock(uint8_t mutex)
+{
+    if(mutex >= MAX_MUTEXES)
+    {
+        return 0;
+    }
+    if(mutexes[mutex].lock && mutexes[mutex].lockedBy == taskCurrent)  //if the current task is locked by mutex
+    {
+        mutexes[mutex].lock = false;                        //then unlock it
+
+        uint8_t nextProcess = waitDequeue(&mutexes[mutex].waiters); //gets the next process in queue
+        if(nextProcess != NO_TASK)                                  //if there is a process waiting
+        {
+            wakeTask(nextProcess);                                  //set that process as ready
+            mutexes[mutex].queueSize--;
+
+            // Next task is now locking the mutex
+            mutexes[mutex].lock = true;
+            mutexes[mutex].lockedBy = nextProcess;      //indicates mutex index is held by next Process
+            recordMutexWait(mutex, nextProcess);
+            restorePriority(nextProcess);               //next owner inherits from the remaining waiters
+        }
+        restorePriority(taskCurrent);                   //drop any priority inherited through this mutex
+        if(nextProcess != NO_TASK && outranksCurrent(nextProcess))
+        {
+            NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;   //the drop may have let the new owner outrank us
+        }
+    }
+    return 0;
+}
+
+uint32_t svcWaitTimeout(uint8_t sema, uint32_t timeout)
+{
+    if(sema >= MAX_SEMAPHORES)
+    {
+        return false;
+    }
+    if(semaphores[sema].count > 0)
+    {
+        semaphores[sema].count--;           //decrement count
+    }
+    else if(timeout == 0)
+    {
+        return false;                       //only trying, do not block
+    }
+    else
+    {
+        readyRemove(taskCurrent);                                                   //take the task off the ready queue
+        waitEnqueue(&semaphores[sema].waiters, semaphores[sema].policy, taskCurrent);   //put the task in queue
+        semaphores[sema].queueSize++;                                               //increment queue count
+        tcb[taskCurrent].state = STATE_BLOCKED_SEMAPHORE;                           //change state to BLOCKED
+        tcb[taskCurrent].semaphore = sema;                                          //put semaphore index in the tcb
+        if(timeout != WAIT_FOREVER)
+        {
+            timerInsert(taskCurrent, timeout);                                      //give up when the timer expires
+            tcb[taskCurrent].timedWait = true;
+        }
+        NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;                                   //call PendSV
+    }
+    return true;
+}
 
-                else if(tcb[task].state == STATE_BLOCKED_SEMAPHORE)                 // Or check if the task is in a Blocked_by_semaphore state
-                {
-                    semaphores[tcb[task].semaphore].count++;
+uint32_t svcWait(uint8_t sema)
+{
+    svcWaitTimeout(sema, WAIT_FOREVER);
+    return 0;
+}
 
-                    if(semaphores[tcb[task].semaphore].queueSize > 0)               // If there are waiting tasks
-                    {
-                        uint8_t nextProcess = semaphores[tcb[task].semaphore].processQueue[0];
-                        tcb[nextProcess].state = STATE_READY;
+uint32_t svcPost(uint8_t sema)
+{
+    uint8_t nextProcess;
+    if(sema >= MAX_SEMAPHORES)
+    {
+        return 0;
+    }
+    nextProcess = waitDequeue(&semaphores[sema].waiters);  //next process in queue takes the count directly
+    if(nextProcess != NO_TASK)              //if some task in the queue
+    {
+        wakeTask(nextProcess);
+        semaphores[sema].queueSize--;              //decrement queue count
+    }
+    else
+    {
+        semaphores[sema].count++;
+    }
+    return 0;
+}
 
-                        uint8_t i = 0;
-                        for(i = 0; i < semaphores[tcb[task].semaphore].queueSize - 1; i++)
-                        {
-                            semaphores[tcb[task].semaphore].processQueue[i] = semaphores[tcb[task].semaphore].processQueue[i + 1];
-                        }
+//Malloc for LengthyFn
+uint32_t svcMalloc(uint32_t size)
+{
+    void* Address = mallocFromHeap(size);
+    tcb[taskCurrent].Allocation = Address;
+    addSramAccessWindow(&tcb[taskCurrent].srd, Address, size);
+    buildSramRegions(tcb[taskCurrent].sramAttr, tcb[taskCurrent].srd);
+    applySramRegions(sramRegionBase, tcb[taskCurrent].sramAttr);
+    return (uint32_t)Address;
+}
 
-                        semaphores[tcb[task].semaphore].queueSize--;
-                        semaphores[tcb[task].semaphore].count--;
-                    }
-                }
+//Free for MallocWrapper buffers the task still owns
+uint32_t svcFree(void *p)
+{
+    msgBuffer buf;
+    buf.data = p;
+    buf.size = allocationSize(p);
+    if(buf.size != 0 && ownsBuffer(taskCurrent, &buf))
+    {
+        setBufferAccess(taskCurrent, &buf, false);
+        freeToHeap(p);
+    }
+    return 0;
+}
 
-                if(mutexes[tcb[task].mutex].lockedBy == task)       // Also check if the task is locking a resource
-                {
-                    mutexes[tcb[task].mutex].lock = false;          // Make the lock as false
-                    //Implement unlock logic
-                    if(mutexes[tcb[task].mutex].queueSize > 0)
-                    {
-                        uint8_t nextProcess = mutexes[tcb[task].mutex].processQueue[0];   //gets the next process in queue
-                        tcb[nextProcess].state = STATE_READY;                   //set that process as ready
+// Blocks the current task on a message queue; msg is where its message is
+// taken from or delivered to when the queue lets it through
+void blockOnQueue(uint8_t queue, uint8_t state, void *msg, uint32_t timeout)
+{
+    readyRemove(taskCurrent);
+    tcb[taskCurrent].state = state;
+    tcb[taskCurrent].queue = queue;
+    tcb[taskCurrent].msg = msg;
+    waitEnqueue(queueWaiters(taskCurrent), queues[queue].policy, taskCurrent);
+    if(timeout != WAIT_FOREVER)
+    {
+        timerInsert(taskCurrent, timeout);
+        tcb[taskCurrent].timedWait = true;
+    }
+    NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+}
 
-                        uint16_t i = 0;
-                        for(i = 0; i < mutexes[tcb[task].mutex].queueSize - 1; i++)
-                        {
-                            mutexes[tcb[task].mutex].processQueue[i] = mutexes[tcb[task].mutex].processQueue[i + 1];
-                        }
-                        mutexes[tcb[task].mutex].queueSize--;
-                        mutexes[tcb[task].mutex].lockedBy = nextProcess;
-                    }
-                }
-                putsUart0(tcb[task].name);
-                putsUart0(" killed. \n");
-                tcb[task].srd = 0xFFFFFFFFFF;               // Change the SRD bits to 1's so that the process cannot R/W
-                tcb[task].state = STATE_STOPPED;            // Set state to STOPPED
-                break;
-            }
-            else if (tcb[task].state == STATE_STOPPED)
-            {
-                putsUart0("Process has already been killed. \n");
-            }
-        }
+// The message (a msgBuffer descriptor for a zero-copy queue) must be
+// memory the sender can read, and a zero-copy send is refused unless the
+// sender owns the whole buffer it describes. A blocked sender's message is
+// read later through tcb[].msg, so it is checked before blocking.
+uint32_t svcQueueSend(uint8_t queue, const void *msg, uint32_t timeout)
+{
+    if(queue >= MAX_QUEUES || queues[queue].depth == 0)
+    {
+        return false;
+    }
+    if(!callerCanRead(msg, queues[queue].msgSize))
+    {
+        return false;
+    }
+    if(queues[queue].mode == QUEUE_ZERO_COPY && !ownsBuffer(taskCurrent, msg))
+    {
+        return false;
+    }
+    if(putMessage(queue, msg, taskCurrent))
+    {
+        return true;
+    }
+    if(timeout == 0)
+    {
+        return false;
     }
+    blockOnQueue(queue, STATE_BLOCKED_SEND, (void*)msg, timeout);
+    return true;                            //replaced by expireWait() if the timeout runs out
 }
 
-// REQUIRED: modify this function to add support for the system timer
-// REQUIRED: in preemptive code, add code to request task switch
-void systickIsr(void)
+// The message is written to msg, possibly later by a sender while the
+// receiver is blocked, so msg must be memory the receiver can write
+uint32_t svcQueueReceive(uint8_t queue, void *msg, uint32_t timeout)
 {
-    uint8_t i = 0;
-    for(i = 0; i < taskCount; i++) //iterate through tcb
+    if(queue >= MAX_QUEUES || queues[queue].depth == 0)
+    {
+        return false;
+    }
+    if(!callerCanWrite(msg, queues[queue].msgSize))
+    {
+        return false;
+    }
+    if(getMessage(queue, msg, taskCurrent))
+    {
+        return true;
+    }
+    if(timeout == 0)
+    {
+        return false;
+    }
+    blockOnQueue(queue, STATE_BLOCKED_RECEIVE, msg, timeout);
+    return true;
+}
+
+uint32_t svcSetEvents(uint8_t group, uint32_t flags)
+{
+    if(group >= MAX_EVENT_GROUPS || !eventGroups[group].used)
+    {
+        return 0;
+    }
+    return raiseEvents(group, flags);
+}
+
+uint32_t svcClearEvents(uint8_t group, uint32_t flags)
+{
+    if(group < MAX_EVENT_GROUPS && eventGroups[group].used)
+    {
+        eventGroups[group].flags &= ~flags;
+    }
+    return 0;
+}
+
+uint32_t svcWaitEvents(uint8_t group, uint32_t mask, uint8_t options, uint32_t timeout)
+{
+    uint32_t matched;
+    if(group >= MAX_EVENT_GROUPS || !eventGroups[group].used || mask == 0)
     {
-        if(tcb[i].state == STATE_DELAYED)
+        return 0;
+    }
+    matched = eventsMatched(eventGroups[group].flags, mask, options);
+    if(matched != 0)
+    {
+        if(options & EVENT_CLEAR)
         {
-            tcb[i].ticks--;
-            if(tcb[i].ticks == 0)  //check if ticks are 0, then change state to ready
-            {
-                tcb[i].state = STATE_READY;
-            }
+            eventGroups[group].flags &= ~matched;
         }
+        return matched;
     }
-
-    if(preemption == true)
+    if(timeout == 0)
     {
-        NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+        return 0;
+    }
+    readyRemove(taskCurrent);
+    tcb[taskCurrent].state = STATE_BLOCKED_EVENT;
+    tcb[taskCurrent].eventGroup = group;
+    tcb[taskCurrent].eventMask = mask;
+    tcb[taskCurrent].eventOptions = options;
+    insertTaskTail(&eventGroups[group].waiters, taskCurrent);
+    if(timeout != WAIT_FOREVER)
+    {
+        timerInsert(taskCurrent, timeout);
+        tcb[taskCurrent].timedWait = true;
     }
+    NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+    return 0;                               //replaced by raiseEvents() with the flags that end the wait
 }
 
+uint32_t svcNotify(_fn fn, uint8_t action, uint32_t value)
+{
+    return sendNotification(fn, action, value);
+}
 
-// REQUIRED: in coop and preemptive, modify this function to add support for task switching
-// REQUIRED: process UNRUN and READY tasks differently
-// The PendSV exception runs at the lowest priority level for context switching when needed.
-// This is needed when the OS code in the SysTick handler needs to carry out a context switch but has detected that the processor is servicing another interrupt.
-__attribute__((naked))void pendSvIsr(void)
+uint32_t svcNotifyTake(bool clear, uint32_t timeout)
 {
-    __asm("  MOV R12, LR ");
-    if((NVIC_FAULT_STAT_R & NVIC_FAULT_STAT_DERR) || (NVIC_FAULT_STAT_R & NVIC_FAULT_STAT_IERR))
+    if(tcb[taskCurrent].notifyValue != 0)
     {
-        NVIC_FAULT_STAT_R |= NVIC_FAULT_STAT_DERR & NVIC_FAULT_STAT_IERR;
-        putsUart0("Called from MPU.\n");
+        return takeNotification(taskCurrent, clear);
     }
+    if(timeout == 0)
+    {
+        return 0;
+    }
+    readyRemove(taskCurrent);
+    tcb[taskCurrent].state = STATE_BLOCKED_NOTIFY;
+    tcb[taskCurrent].notifyClear = clear;
+    if(timeout != WAIT_FOREVER)
+    {
+        timerInsert(taskCurrent, timeout);
+        tcb[taskCurrent].timedWait = true;
+    }
+    NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
+    return 0;                               //replaced by sendNotification() with the word taken
+}
 
-    pushREGS();                             //save registers
-    tcb[taskCurrent].sp = (void*)getPSP();  //save psp
-    taskCurrent = rtosScheduler();          //call scheduler
+uint32_t svcSerialWrite(const char str[], uint32_t len)
+{
+    if(len == 0 || !callerCanRead(str, len))
+    {
+        return 0;
+    }
+    return writeUart0(str, len);
+}
 
-    setPSP(tcb[taskCurrent].sp);            //restore PSP
-    applySramAccessMask(tcb[taskCurrent].srd); //restore SRD
-    popREGS();                              //restore regs
+uint32_t svcSerialRead(char str[], uint32_t len)
+{
+    if(len == 0)
+    {
+        return availableUart0();
+    }
+    if(!callerCanWrite(str, len))
+    {
+        return 0;
+    }
+    return readUart0(str, len);
 }
 
-// REQUIRED: modify this function to add support for the service call
-// REQUIRED: in preemptive code, add code to handle synchronization primitives
-// SVC handles cases even when in unpriveleged mode.
-void svCallIsr(void)
+// The controller reads the buffer with the kernel's rights, so it must be
+// flash or heap memory the caller could read itself
+uint32_t svcSerialDma(const char str[], uint32_t len)
 {
-    uint32_t SvcNum = getSVCnum();
-    uint32_t* psp = getPSP();
+    if (len == 0 || len > DMA_MAX_TRANSFER || !callerCanRead(str, len))
+        return UART0_DMA_INVALID;
+    if (!startUart0Dma(str, len))
+        return UART0_DMA_BUSY;
+    if (eventGroups[uart0Events].used)
+        eventGroups[uart0Events].flags &= ~UART0_TX_DONE;  //only this transfer's completion counts
+    return UART0_DMA_STARTED;
+}
 
-    switch(SvcNum)
+uint32_t svcPoolGet(uint8_t pool)
+{
+    msgBuffer buf;
+    if(pool >= MAX_POOLS)
     {
-    //Launch Task
-    case 0:
+        return 0;
+    }
+    buf.data = getBlock(&pools[pool], taskCurrent);
+    buf.size = pools[pool].blockSize;
+    if(buf.data != 0)
     {
-        taskCurrent = rtosScheduler();
-        applySramAccessMask(tcb[taskCurrent].srd); //restore SRD mask
-        setPSP(tcb[taskCurrent].sp);               //restore PSP
-        popREGS();                  //restore registers - Popping the registers
-        break;
+        setBufferAccess(taskCurrent, &buf, true);
     }
+    return (uint32_t)buf.data;
+}
 
-    //Yield
-    case 1:
+uint32_t svcPoolPut(uint8_t pool, void *block)
+{
+    msgBuffer buf;
+    if(pool >= MAX_POOLS)
+    {
+        return false;
+    }
+    buf.data = block;
+    buf.size = pools[pool].blockSize;
+    if(!putBlock(&pools[pool], block, taskCurrent))          //only the task holding the block
+    {
+        return false;
+    }
+    if(!blockWindowHeld(&pools[pool], block))               //nothing left in use in these subregions
     {
-        NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;   //Calls PendSV
-        break;
+        setBufferAccess(taskCurrent, &buf, false);
     }
+    return true;
+}
 
-    //Sleep
-    case 2:
+//===========================SHELL INTERFACE================================//
+uint32_t svcSetScheduler(uint8_t mode)
+{
+    if(mode == SCHED_RR || mode == SCHED_PRIO || mode == SCHED_EDF)
     {
-        uint32_t Taskticks = *psp;                      //grabs the value of the ticks from PSP address
-        tcb[taskCurrent].state = STATE_DELAYED;     //changes the state of the current task to DELAYED
-        tcb[taskCurrent].ticks = Taskticks;         //Stores the value of ticks to the TCB
-        NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;   //Calls the PendSV for context switching
-        break;
+        schedulerMode = mode;
     }
+    return 0;
+}
+
+uint32_t svcSetPreemption(bool on)
+{
+    preemption = on;
+    return 0;
+}
+
+uint32_t svcSetPriorityInheritance(bool on)
+{
+    priorityInheritance = on;
+    return 0;
+}
 
-    //Lock - check if same task is locked or not
-    case 3:
+//PIDOF - 0 if no thread has that name
+uint32_t svcGetPid(const char name[])
+{
+    uint8_t i = 0;
+    for(i = 0; i < MAX_TASKS; i++)
     {
-        int8_t mutex = *psp;
-        if(mutexes[mutex].lock == false)            //if mutex index is not locked
-        {
-            mutexes[mutex].lock = true;             //lock it
-            mutexes[mutex].lockedBy = taskCurrent;  //indicate the mutex index is locked by the current task
-            tcb[mutex].mutex = mutex;               //store the mutex index in the TCB
-        }
-        else if(mutexes[mutex].lockedBy != taskCurrent)
-        {
-            tcb[taskCurrent].state = STATE_BLOCKED_MUTEX;
-            mutexes[mutex].processQueue[mutexes[mutex].queueSize] = taskCurrent;  //marking that a thread is blocked by adding it to the process queue, which requires the size of the queue.
-            mutexes[mutex].queueSize++;
-            tcb[mutex].mutex = mutex;               //store the mutex index in the TCB
-            NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
-        }
-        else
+        if(tcb[i].state != STATE_INVALID && (cmpStr(tcb[i].name, name)) == 0)
         {
-            //Kill that thread
+            return (uint32_t)tcb[i].pid;
         }
-        break;
     }
+    return 0;
+}
+
+uint32_t svcReboot(void)
+{
+    NVIC_APINT_R = (NVIC_APINT_VECTKEY | NVIC_APINT_SYSRESETREQ);      //System Reset Request
+    return 0;
+}
+//====================================================================//
+
+uint32_t svcStopThread(_fn fn)
+{
+    KillThread((void*)fn);
+    return 0;
+}
+
+// fn is either the thread's pid or its name
+uint32_t svcRestartThread(_fn fn)
+{
+    uint32_t TaskPID = (uint32_t)fn;                    // Get the PID if Kill() is called or from function call
+    char *TaskName = (char *)fn;                        // Get the task Name passed into restartthread()
 
-    //Unlock
-    case 4:
+    uint8_t task = 0;
+    for(task = 0; task < MAX_TASKS; task++)             // Go through the TCB
     {
-        int8_t mutex = *psp;
-        if(mutexes[mutex].lockedBy == taskCurrent)              //if the current task is locked by mutex
+        if((TaskPID == (uint32_t)tcb[task].pid) || ((cmpStr(tcb[task].name, TaskName)) == 0))
         {
-            mutexes[mutex].lock = false;                        //then unlock it
-
-            if(mutexes[mutex].queueSize > 0)                        //if there is a process waiting
+            if(tcb[task].state == STATE_STOPPED)        //check for process states so that only stopped ones get restarted or else mem error might occur
             {
-                uint8_t nextProcess = mutexes[mutex].processQueue[0];   //gets the next process in queue
-                tcb[nextProcess].state = STATE_READY;                   //set that process as ready
-                uint16_t i = 0;
-                for(i = 1; i < mutexes[mutex].queueSize; i++)
+                // allocate the stack and size to SP
+                uint32_t* NewAllocation = mallocFromHeap(tcb[task].ThreadSize);
+                if(NewAllocation == 0)                  // Heap exhausted: the task stays STOPPED
                 {
-                    mutexes[mutex].processQueue[i - 1] = mutexes[mutex].processQueue[i];
+                    putsUart0("Cannot restart. Not enough memory.\n");
+                    break;
                 }
-                mutexes[mutex].queueSize--;
 
-                // Next task is now locking the mutex
-                mutexes[mutex].lock = true;
-                mutexes[mutex].lockedBy = nextProcess;      //indicates mutex index is held by next Process
+                uint32_t* p = (uint32_t*)((uint32_t)NewAllocation + RoundUp(tcb[task].ThreadSize) - 4);
+                tcb[task].sp = (void*)p;
+                tcb[task].spInit = tcb[task].sp;
+                tcb[task].BaseAddress = NewAllocation;
+                tcb[task].ticks = 0;
+                tcb[task].currentPriority = tcb[task].priority;
+                resetPeriodicStats(task);
+                tcb[task].fpuUsed = false;
+                tcb[task].notifyValue = 0;
+                fillStack(task);
+                addSramAccessWindow(&tcb[task].srd, NewAllocation, tcb[task].ThreadSize);
+                buildSramRegions(tcb[task].sramAttr, tcb[task].srd);
+
+                //Hardware push pop
+                *(--p) = 0x01000000;     // xPSR (valid bit)
+                *(--p) = (uint32_t)tcb[task].pid;     // Pid to pc
+                *(--p) = 0x00000001;     // LR trash value doesn't matter
+                *(--p) = 0x12121212;     // R12
+                *(--p) = 0x03030303;     // R3
+                *(--p) = 0x02020202;     // R2
+                *(--p) = 0x01010101;     // R1
+                *(--p) = 0x0000001A;     // R0
+                //Software push pop
+                *(--p) = 0xDEAD0011;     // R11
+                *(--p) = 0xDEAD0010;     // R10
+                *(--p) = 0xDEAD0009;     // R9
+                *(--p) = 0xDEAD0008;     // R8
+                *(--p) = 0xDEAD0007;     // R7
+                *(--p) = 0xDEAD0006;     // R6
+                *(--p) = 0xDEAD0005;     // R5
+                *(--p) = 0xDEAD0004;     // R4
+                *(--p) = EXC_RETURN_THREAD_PSP;    // EXC_RETURN Value
+
+                tcb[task].sp = p;
+
+                wakeTask(task);                 // STATE to ready
+                putsUart0(tcb[task].name);
+                putsUart0(" restarted. \n");
             }
+            else
+            {
+                putsUart0("Cannot restart. Process already running.\n");
+            }
+            break;
         }
-        break;
-    }
-
-    //wait
-    case 5:
-    {
-        int8_t sema = *psp;
-        if(semaphores[sema].count > 0)
-        {
-            semaphores[sema].count--;           //decrement count
-        }
-        else
-        {
-            semaphores[sema].processQueue[semaphores[sema].queueSize] = taskCurrent;    //put the task in queue
-            semaphores[sema].queueSize++;                                               //increment queue count
-            tcb[taskCurrent].state = STATE_BLOCKED_SEMAPHORE;                           //change state to BLOCKED
-            tcb[taskCurrent].semaphore = sema;                                          //put semaphore index in the tcb
-            NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;                                   //call PendSV
-        }
-        break;
     }
+    return 0;
+}
 
-    //post
-    case 6:
+// Changes the base priority; an inherited boost stays in effect until the
+// mutex is released
+uint32_t svcSetThreadPriority(_fn fn, uint8_t priority)
+{
+    uint8_t task = 0;
+    for(task = 0; task < MAX_TASKS; task++)
     {
-        int8_t sema = *psp;
-        semaphores[sema].count++;
-        if(semaphores[sema].queueSize > 0)      //if some task in the queue
+        if(tcb[task].state != STATE_INVALID && tcb[task].pid == fn && priority < NUM_PRIORITIES)
         {
-            uint8_t nextProcess = semaphores[sema].processQueue[0];     //make next task ready by getting next process in queue
-            tcb[nextProcess].state = STATE_READY;
-            uint16_t i = 0;
-            for(i = 1; i < semaphores[sema].queueSize; i++)
+            tcb[task].priority = priority;
+            restorePriority(task);          //may also move a mutex holder it is blocked on
+            if(readyOutranksCurrent())
             {
-                semaphores[sema].processQueue[i-1] = semaphores[sema].processQueue[i];  //move the user in queue
+                NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
             }
-            semaphores[sema].queueSize--;              //decrement queue count
-            semaphores[sema].count--;
-            tcb[sema].semaphore = sema;               //store the semaphore index in the TCB
+            break;
         }
-        break;
     }
+    return 0;
+}
 
-    case 7: //Malloc for LengthyFn
+//IPCS
+uint32_t svcGetMutexSemaInfo(ExtractMutexSema *info)
+{
+    uint8_t i, j, task;
+    if (!callerCanWrite(info, sizeof(ExtractMutexSema) * (MAX_MUTEXES + MAX_SEMAPHORES)))
+        return 0;
+    for (i = 0; i < MAX_MUTEXES; i++)
     {
-        uint16_t Size = *psp;                                    //gets 5000 from R0
-        void* Address = mallocFromHeap(Size);           //returns 0x20006C00. Ends at 0x20007C00
-        tcb[taskCurrent].Allocation = Address;
-        addSramAccessWindow(&tcb[taskCurrent].srd, Address, Size);
-        applySramAccessMask(tcb[taskCurrent].srd);                   //srdBits = 0x07.FFFF.FFFF
-        *psp = (uint32_t)Address;                       //Stores 0x20006C00 into r0
-        break;
+        info[i].lock = mutexes[i].lock;
+        info[i].MutexLockedBy = mutexes[i].lockedBy;
+        info[i].MutexQueueSize = mutexes[i].queueSize;
+        task = mutexes[i].waiters.head;
+        for (j = 0; j < MAX_MUTEX_QUEUE_SIZE; j++)
+        {
+            info[i].MutexProcessQueue[j] = (task != NO_TASK) ? task : 0;
+            task = (task != NO_TASK) ? tcb[task].next : NO_TASK;
+        }
+        info[i].MutexMaxBlocked = mutexes[i].maxBlocked;
+        info[i].MutexMaxBlockedTask = mutexes[i].maxBlockedTask;
     }
-
-    //===========================SHELL INTERFACE================================//
-    case 8:                                 //SCHEDULER
+    for (i = 0; i < MAX_SEMAPHORES; i++)
     {
-        priorityScheduler = *getPSP();
-        break;
+        ExtractMutexSema *entry = &info[MAX_MUTEXES + i];
+        entry->SemaCount = semaphores[i].count;
+        entry->SemaQueueSize = semaphores[i].queueSize;
+        task = semaphores[i].waiters.head;
+        for (j = 0; j < MAX_SEMAPHORE_QUEUE_SIZE; j++)
+        {
+            entry->SemaQueue[j] = (task != NO_TASK) ? task : 0;
+            task = (task != NO_TASK) ? tcb[task].next : NO_TASK;
+        }
     }
+    return 0;
+}
 
-    case 9:                                //PREEMPTION
+uint32_t svcGetQueueInfo(ExtractQueue *info)
+{
+    uint8_t i, task;
+    if (!callerCanWrite(info, sizeof(ExtractQueue) * MAX_QUEUES))
+        return 0;
+    for (i = 0; i < MAX_QUEUES; i++)
     {
-        preemption = *getPSP();
-        break;
+        info[i].depth = queues[i].depth;
+        info[i].msgSize = queues[i].msgSize;
+        info[i].mode = queues[i].mode;
+        info[i].count = queues[i].count;
+        info[i].maxCount = queues[i].maxCount;
+        info[i].sendersWaiting = 0;
+        for (task = queues[i].senders.head; task != NO_TASK; task = tcb[task].next)
+        {
+            info[i].sendersWaiting++;
+        }
+        info[i].receiversWaiting = 0;
+        for (task = queues[i].receivers.head; task != NO_TASK; task = tcb[task].next)
+        {
+            info[i].receiversWaiting++;
+        }
     }
+    return 0;
+}
 
-    case 10:                              //PRIORITY INHERITANCE
+uint32_t svcGetEventInfo(ExtractEvents *info)
+{
+    uint8_t i, task;
+    if (!callerCanWrite(info, sizeof(ExtractEvents) * MAX_EVENT_GROUPS))
+        return 0;
+    for (i = 0; i < MAX_EVENT_GROUPS; i++)
     {
-        priorityInheritance = *getPSP();
-        break;
+        info[i].used = eventGroups[i].used;
+        info[i].flags = eventGroups[i].flags;
+        info[i].waiting = 0;
+        for (task = eventGroups[i].waiters.head; eventGroups[i].used && task != NO_TASK; task = tcb[task].next)
+        {
+            info[i].waiting++;
+        }
     }
+    return 0;
+}
 
-    case 11:                            //PIDOF
+uint32_t svcWaitNextPeriod(void)
+{
+    struct _tcb *task = &tcb[taskCurrent];
+    periodicThread *p;
+    if (task->periodic != NO_PERIODIC)
     {
-        char *ThreadName = (char*)*getPSP();    //gets the thread name passed
-        uint8_t i = 0;
-        bool found = 0;
-        uint16_t pidValue = 0;
-        char str[15];
-
-        for(i = 0; i < MAX_TASKS; i++)
+        p = &periodics[task->periodic];
+        p->paced = true;                                    //sleep() no longer moves its schedule
+        //systemTicks reaches absDeadline as the deadline passes, so finishing on that tick is late
+        if ((int32_t)(systemTicks - task->absDeadline) >= 0)
         {
-            if((cmpStr(tcb[i].name, ThreadName)) == 0)
-            {
-                found = 1;
-                //*getPSP() = (uint32_t)tcb[i].pid;
-                pidValue = (uint32_t)tcb[i].pid;
-                break;
-            }
+            p->deadlineMisses++;
         }
-
-        if(!found)
+        p->release += p->period;                            //absolute schedule, no drift
+        task->releasePending = true;
+        if ((int32_t)(p->release - systemTicks) > 0)
         {
-            *getPSP() = 0;
-            putsUart0("PID not found.\n");
+            readyRemove(taskCurrent);
+            task->state = STATE_DELAYED;
+            timerInsert(taskCurrent, p->release - systemTicks);
+            NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV;
         }
-        else if(found == 1)
+        else                                                //overran: the next release is already due
         {
-            IntToStr(pidValue, str);
-            putsUart0("PID: ");
-            putsUart0(str);
-            putcUart0('\n');
+            releaseJob(taskCurrent, DWT_CYCCNT_R - (systemTicks - p->release) * CYCLES_PER_TICK);
         }
-        break;
     }
+    return 0;
+}
 
-    case 12:                            //REBOOT
+//PS / MEMINFO
+uint32_t svcGetTCBinfo(ExtractTCB *info)
+{
+    uint8_t i, n = 0;
+    if (!callerCanWrite(info, sizeof(ExtractTCB) * MAX_TASKS))
+        return 0;
+    for (i = 0; i < MAX_TASKS; i++)
     {
-        NVIC_APINT_R = (NVIC_APINT_VECTKEY | NVIC_APINT_SYSRESETREQ);      //System Reset Request
-        break;
+        if (tcb[i].state != STATE_INVALID)
+        {
+            info[n].state = tcb[i].state;
+            info[n].pid = (uint32_t)tcb[i].pid;
+            StringCopy(tcb[i].name, info[n].name);
+            info[n].priority = tcb[i].priority;
+            info[n].BaseAddr = tcb[i].BaseAddress;
+            info[n].ThreadSize = tcb[i].ThreadSize;
+            info[n].CPU_TIME = (cpuWindowCycles != 0) ? (uint32_t)(((uint64_t)tcb[i].cpuTime[cpuActive ^ 1] * 10000) / cpuWindowCycles) : 0;
+            info[n].LockedBy = (tcb[i].state == STATE_BLOCKED_MUTEX) ? mutexes[tcb[i].mutex].lockedBy : 0;
+            info[n].period = 0;
+            info[n].deadlineMisses = 0;
+            info[n].jitterMin = 0;
+            info[n].jitterMax = 0;
+            info[n].jitterMean = 0;
+            if (tcb[i].periodic != NO_PERIODIC)
+            {
+                periodicThread *p = &periodics[tcb[i].periodic];
+                info[n].period = p->period;
+                info[n].deadlineMisses = p->deadlineMisses;
+                info[n].jitterMin = (p->jitterCount != 0) ? p->jitterMin : 0;
+                info[n].jitterMax = p->jitterMax;
+                info[n].jitterMean = (p->jitterCount != 0) ? (uint32_t)(p->jitterSum / p->jitterCount) : 0;
+            }
+            info[n].fpuUsed = tcb[i].fpuUsed;
+            info[n].stackUsed = (uint32_t)tcb[i].spInit + 4 - (uint32_t)tcb[i].sp;
+            info[n].stackPeak = tcb[i].stackPeak;
+            n++;
+        }
     }
-    //====================================================================//
-
-    //Stop thread
-    case 13:
+    for (; n < MAX_TASKS; n++)
     {
-        uint32_t TaskPID = *getPSP();
-        KillThread((void*)TaskPID);
-        break;
+        info[n].ThreadSize = 0;                         //marks the end of the list
     }
+    return 0;
+}
+
+//CPU usage
+uint32_t svcGetCpuInfo(ExtractCpu *info)
+{
+    if (!callerCanWrite(info, sizeof(ExtractCpu)))
+        return 0;
+    info->idle = cpuIdle;
+    info->load1 = cpuLoad[0];
+    info->load5 = cpuLoad[1];
+    info->load15 = cpuLoad[2];
+    info->windowMs = CPU_WINDOW_MS;
+    return 0;
+}
+
+//Heap usage
+uint32_t svcGetHeapInfo(heapStats *info)
+{
+    if (!callerCanWrite(info, sizeof(heapStats)))
+        return 0;
+    getHeapStats(info);
+    return 0;
+}
 
-    //RESTART THREAD
-    case 14:
+//Stack high-water scan, a bounded slice per call. A stopped thread's stack
+//has been freed, so it is skipped and keeps the peak it had when killed.
+uint32_t svcScanStacks(void)
+{
+    uint8_t n = 0;
+    while (tcb[stackScanTask].state == STATE_INVALID || tcb[stackScanTask].state == STATE_STOPPED)
     {
-        uint32_t TaskPID = *getPSP();                       // Get the PID if Kill() is called or from function call
-        char *TaskName = (char *)*getPSP();                  // Get the task Name passed into restartthread()
+        stackScanTask = (stackScanTask + 1) % MAX_TASKS;
+        if (++n == MAX_TASKS)
+            return 0;
+    }
 
-        uint8_t task = 0;
-        for(task = 0; task < MAX_TASKS; task++)             // Go through the TCB
+    struct _tcb *task = &tcb[stackScanTask];
+    uint32_t top = (uint32_t)task->spInit + 4;
+    uint32_t *limit = (uint32_t*)(top - task->stackPeak);
+    uint32_t *p = task->stackScan;
+    for (n = 0; n < STACK_SCAN_WORDS && p < limit; n++, p++)
+    {
+        if (*p != STACK_FILL)
         {
-            if((TaskPID == (uint32_t)tcb[task].pid) || ((cmpStr(tcb[task].name, TaskName)) == 0))
-            {
-                if(tcb[task].state == STATE_STOPPED)        //check for process states so that only stopped ones get restarted or else mem error might occur
-                {
-                    // allocate the stack and size to SP
-                    uint32_t* NewAllocation = mallocFromHeap(tcb[task].ThreadSize);
-
-                    uint32_t* p = (uint32_t*)((uint32_t)NewAllocation + RoundUp(tcb[task].ThreadSize) - 4);
-                    tcb[task].sp = (void*)p;
-                    tcb[task].spInit = tcb[task].sp;
-                    tcb[task].BaseAddress = NewAllocation;
-                    tcb[task].ticks = 0;
-                    addSramAccessWindow(&tcb[task].srd, NewAllocation, tcb[task].ThreadSize);
-
-                    //Hardware push pop
-                    *(--p) = 0x01000000;     // xPSR (valid bit)
-                    *(--p) = (uint32_t)tcb[task].pid;     // Pid to pc
-                    *(--p) = 0x00000001;     // LR trash value doesn't matter
-                    *(--p) = 0x12121212;     // R12
-                    *(--p) = 0x03030303;     // R3
-                    *(--p) = 0x02020202;     // R2
-                    *(--p) = 0x01010101;     // R1
-                    *(--p) = 0x0000001A;     // R0
-                    //Software push pop
-                    *(--p) = 0xDEAD0004;     // R4
-                    *(--p) = 0xDEAD0005;     // R5
-                    *(--p) = 0xDEAD0006;     // R6
-                    *(--p) = 0xDEAD0007;     // R7
-                    *(--p) = 0xDEAD0008;     // R8
-                    *(--p) = 0xDEAD0009;     // R9
-                    *(--p) = 0xDEAD0010;     // R10
-                    *(--p) = 0xDEAD0011;     // R11
-                    *(--p) = (uint32_t)0xFFFFFFFD;     // EXC_RETURN Value
-
-                    tcb[task].sp = p;
-
-                    tcb[task].state = STATE_READY;  // STATE to ready
-                    putsUart0(tcb[task].name);
-                    putsUart0(" restarted. \n");
-                    break;
-                }
-                else
-                {
-                    putsUart0("Cannot restart. Process already running.\n");
-                    break;
-                }
-            }
+            task->stackPeak = top - (uint32_t)p;
+            break;
         }
-        break;
     }
-
+    if (n < STACK_SCAN_WORDS)
+    {
+        task->stackScan = task->BaseAddress;        // new peak or reached the old one
+        stackScanTask = (stackScanTask + 1) % MAX_TASKS;
+    }
+    else
+    {
+        task->stackScan = p;
     }
+    return 0;
 }
 
+// handlers indexed by service call number
+const _syscall syscallTable[NUM_SYSCALLS] =
+{
+    [SVC_LAUNCH]                = (_syscall)svcLaunch,
+    [SVC_YIELD]                 = (_syscall)svcYield,
+    [SVC_SLEEP]                 = (_syscall)svcSleep,
+    [SVC_LOCK]                  = (_syscall)svcLock,
+    [SVC_UNLOCK]                = (_syscall)svcUnlock,
+    [SVC_WAIT]                  = (_syscall)svcWait,
+    [SVC_POST]                  = (_syscall)svcPost,
+    [SVC_MALLOC]                = (_syscall)svcMalloc,
+    [SVC_SCHED]                 = (_syscall)svcSetScheduler,
+    [SVC_PREEMPT]               = (_syscall)svcSetPreemption,
+    [SVC_PI]                    = (_syscall)svcSetPriorityInheritance,
+    [SVC_PIDOF]                 = (_syscall)svcGetPid,
+    [SVC_REBOOT]                = (_syscall)svcReboot,
+    [SVC_STOP_THREAD]           = (_syscall)svcStopThread,
+    [SVC_RESTART_THREAD]        = (_syscall)svcRestartThread,
+    [SVC_SET_PRIORITY]          = (_syscall)svcSetThreadPriority,
+    [SVC_MUTEX_SEMA_INFO]       = (_syscall)svcGetMutexSemaInfo,
+    [SVC_WAIT_NEXT_PERIOD]      = (_syscall)svcWaitNextPeriod,
+    [SVC_TCB_INFO]              = (_syscall)svcGetTCBinfo,
+    [SVC_CPU_INFO]              = (_syscall)svcGetCpuInfo,
+    [SVC_LOCK_TIMEOUT]          = (_syscall)svcLockTimeout,
+    [SVC_WAIT_TIMEOUT]          = (_syscall)svcWaitTimeout,
+    [SVC_QUEUE_SEND]            = (_syscall)svcQueueSend,
+    [SVC_QUEUE_RECEIVE]         = (_syscall)svcQueueReceive,
+    [SVC_FREE]                  = (_syscall)svcFree,
+    [SVC_QUEUE_INFO]            = (_syscall)svcGetQueueInfo,
+    [SVC_SET_EVENTS]            = (_syscall)svcSetEvents,
+    [SVC_CLEAR_EVENTS]          = (_syscall)svcClearEvents,
+    [SVC_WAIT_EVENTS]           = (_syscall)svcWaitEvents,
+    [SVC_EVENT_INFO]            = (_syscall)svcGetEventInfo,
+    [SVC_NOTIFY]                = (_syscall)svcNotify,
+    [SVC_NOTIFY_TAKE]           = (_syscall)svcNotifyTake,
+    [SVC_SERIAL_WRITE]          = (_syscall)svcSerialWrite,
+    [SVC_SERIAL_READ]           = (_syscall)svcSerialRead,
+    [SVC_SERIAL_DMA]            = (_syscall)svcSerialDma,
+    [SVC_POOL_GET]              = (_syscall)svcPoolGet,
+    [SVC_POOL_PUT]              = (_syscall)svcPoolPut,
+    [SVC_HEAP_INFO]             = (_syscall)svcGetHeapInfo,
+    [SVC_STACK_SCAN]            = (_syscall)svcScanStacks,
+};
+
+// REQUIRED: modify this function to add support for the service call
+// REQUIRED: in preemptive code, add code to handle synchronization primitives
+// SVC handles cases even when in unpriveleged mode.
+// The wrapper leaves the call number in R12 and its arguments in R0-R3; the
+// exception stacks all five, so no decoding of the SVC opcode is needed.
+void svCallIsr(void)
+{
+    uint32_t* psp = getPSP();
+    uint32_t SvcNum = psp[4];               //stacked R12
+    uint32_t state = enterCritical();
+
+    if(SvcNum < NUM_SYSCALLS)
+    {
+        psp[0] = syscallTable[SvcNum](psp[0], psp[1], psp[2], psp[3]);  //result to the stacked R0
+    }
+    leaveCritical(state);
+}
@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "mm.h"
 
 //-----------------------------------------------------------------------------
 // RTOS Defines and Kernel Variables
@@ -27,44 +28,211 @@ typedef void (*_fn)();
 
 // mutex
 #define MAX_MUTEXES 1
-#define MAX_MUTEX_QUEUE_SIZE 2
+#define MAX_MUTEX_QUEUE_SIZE MAX_TASKS       // waiters reported by ipcs (wait queues are unbounded)
 #define resource 0
 
 // semaphore
 #define MAX_SEMAPHORES 3
-#define MAX_SEMAPHORE_QUEUE_SIZE 2
+#define MAX_SEMAPHORE_QUEUE_SIZE MAX_TASKS   // waiters reported by ipcs
 #define keyPressed 0
 #define keyReleased 1
 #define flashReq 2
 
-// tasks
+// message queues
+#define MAX_QUEUES 2
+#define MAX_QUEUE_DEPTH 8
+#define MAX_MSG_SIZE 16
+
+// event flag groups
+#define MAX_EVENT_GROUPS 2
+#define uart0Events 0                        // UART0_RX_READY and UART0_TX_SPACE from uart0Isr()
+
+// fixed-size block pools
+#define MAX_POOLS 2
+
+// threads created with createPeriodicThread()
+#define MAX_PERIODIC 4
+
+// tasks (at most 255: task indices are uint8_t and 0xFF is NO_TASK)
+#ifndef MAX_TASKS
 #define MAX_TASKS 12
+#endif
+
+// interrupt priorities (0 is the most urgent; the NVIC keeps 3 bits)
+// SVCall, PendSV and SysTick run at KERNEL_PRIORITY. Kernel critical
+// sections mask priorities MAX_SYSCALL_PRIORITY and below, so only
+// interrupts in that range may call the FromIsr functions. Interrupts at
+// more urgent priorities are never delayed by the kernel.
+#define KERNEL_PRIORITY      7
+#define MAX_SYSCALL_PRIORITY 2
+
+// timeout of lockTimeout() and waitTimeout() that never expires
+#define WAIT_FOREVER 0xFFFFFFFF
+
+// wait queue policies (order waiters are woken in)
+#define QUEUE_FIFO 0
+#define QUEUE_PRIO 1
+
+// message queue modes
+#define QUEUE_COPY      0   // message bytes are copied into and out of the queue
+#define QUEUE_ZERO_COPY 1   // messages are msgBuffer descriptors of heap buffers
+
+// waitEventFlags() options
+#define EVENT_WAIT_ANY  0   // wake when any bit of the mask is set
+#define EVENT_WAIT_ALL  1   // wake when every bit of the mask is set
+#define EVENT_CLEAR     2   // clear the bits that ended the wait
+
+// notify() actions on the target's notification word
+#define NOTIFY_GIVE       0 // add one, like post()
+#define NOTIFY_SET_BITS   1 // OR in the value, like setEventFlags()
+#define NOTIFY_OVERWRITE  2 // replace the word with the value
+
+// scheduler modes
+#define SCHED_RR   0
+#define SCHED_PRIO 1
+#define SCHED_EDF  2
+
+// thread snapshot reported by the ps, meminfo and stack commands
+typedef struct _ExtractTCB
+{
+    uint8_t state;
+    uint32_t pid;
+    char name[16];
+    uint8_t priority;
+    uint32_t* BaseAddr;
+    uint32_t ThreadSize;           // 0 marks the end of the list
+    uint32_t CPU_TIME;             // CPU usage in hundredths of a percent
+    uint8_t LockedBy;              // owner of the mutex the thread is blocked on
+    uint32_t period;               // 0 if the thread is not periodic
+    uint32_t deadlineMisses;
+    uint32_t jitterMin;            // release jitter (us)
+    uint32_t jitterMax;
+    uint32_t jitterMean;
+    bool fpuUsed;                  // thread has an FP context to switch
+    uint32_t stackUsed;            // stack in use when the thread last switched out (bytes)
+    uint32_t stackPeak;            // deepest stack use seen (bytes)
+} ExtractTCB;
+
+// CPU usage reported by the ps command (hundredths of a percent)
+typedef struct _ExtractCpu
+{
+    uint32_t idle;                 // idle time in the last window
+    uint32_t load1;                // non-idle time averaged over 1, 5 and 15 s
+    uint32_t load5;
+    uint32_t load15;
+    uint32_t windowMs;             // length of the measurement window
+} ExtractCpu;
+
+// mutex and semaphore status reported by the ipcs command
+// entries [0, MAX_MUTEXES) are mutexes, the rest are semaphores
+typedef struct _ExtractMutexSema
+{
+    bool lock;
+    uint8_t MutexLockedBy;
+    uint8_t MutexQueueSize;
+    uint8_t MutexProcessQueue[MAX_MUTEX_QUEUE_SIZE];
+    uint32_t MutexMaxBlocked;      // worst-case wait for the mutex (ms)
+    uint8_t MutexMaxBlockedTask;   // task that saw the worst-case wait
+    uint8_t SemaCount;
+    uint8_t SemaQueueSize;
+    uint8_t SemaQueue[MAX_SEMAPHORE_QUEUE_SIZE];
+} ExtractMutexSema;
+
+// message of a QUEUE_ZERO_COPY queue: a buffer from MallocWrapper() that
+// changes owner (and MPU access) from the sender to the receiver
+typedef struct _msgBuffer
+{
+    void *data;
+    uint32_t size;
+} msgBuffer;
+
+// message queue status reported by the ipcs command
+typedef struct _ExtractQueue
+{
+    uint8_t depth;                 // 0 if the queue is not initialized
+    uint8_t msgSize;
+    uint8_t mode;
+    uint8_t count;                 // messages in the queue
+    uint8_t maxCount;              // high-water mark
+    uint8_t sendersWaiting;        // tasks blocked on a full queue
+    uint8_t receiversWaiting;      // tasks blocked on an empty queue
+} ExtractQueue;
+
+// event flag group status reported by the ipcs command
+typedef struct _ExtractEvents
+{
+    bool used;                     // false if the group is not initialized
+    uint32_t flags;
+    uint8_t waiting;               // tasks blocked in waitEventFlags()
+} ExtractEvents;
 
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
-bool initMutex(uint8_t mutex);
-bool initSemaphore(uint8_t semaphore, uint8_t count);
+bool initMutex(uint8_t mutex, uint8_t policy);
+bool initSemaphore(uint8_t semaphore, uint8_t count, uint8_t policy);
+bool initQueue(uint8_t queue, uint8_t depth, uint8_t msgSize, uint8_t mode, uint8_t policy);
+bool initEventGroup(uint8_t group);
 
 void initRtos(void);
 void startRtos(void);
 
 bool createThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes);
+bool createPeriodicThread(_fn fn, const char name[], uint8_t priority, uint32_t stackBytes,
+                          uint32_t periodMs, uint32_t deadlineMs);
 void restartThread(_fn fn);
 void stopThread(_fn fn);
 void setThreadPriority(_fn fn, uint8_t priority);
-void* MallocWrapper(uint32_t SizeInBytes);
+void FreeWrapper(void *p);
 void* PIDgetter(void);
 void KillThread(void* arg);
+void getMutexSemaInfo(ExtractMutexSema *info);
+void getQueueInfo(ExtractQueue *info);
+void getEventInfo(ExtractEvents *info);
+void getTCBinfo(ExtractTCB *info);
+void getCpuInfo(ExtractCpu *info);
+void getHeapInfo(heapStats *info);
+void scanStacks(void);
+void setSchedulerMode(uint8_t mode);
+void setPreemption(bool on);
+void setPriorityInheritance(bool on);
+void reboot(void);
 
 void yield(void);
 void sleep(uint32_t tick);
+void waitNextPeriod(void);
 void lock(int8_t mutex);
 void unlock(int8_t mutex);
 void wait(int8_t semaphore);
 void post(int8_t semaphore);
-
+void postFromIsr(uint8_t semaphore);
+bool queueSendFromIsr(uint8_t queue, const void *msg);
+uint32_t setEventFlagsFromIsr(uint8_t group, uint32_t flags);
+void clearEventFlags(uint8_t group, uint32_t flags);
+bool notifyFromIsr(_fn fn, uint8_t action, uint32_t value);
+bool initPool(uint8_t pool, uint16_t blockSize, uint16_t blocks);
+void *poolGetFromIsr(uint8_t pool);
+bool poolPutFromIsr(uint8_t pool, void *block);
+uint32_t enterCritical(void);
+void leaveCritical(uint32_t state);
+
+// service calls that return a value (wrappers in sp.s)
+extern void* MallocWrapper(uint32_t SizeInBytes);
+extern uint32_t getPid(const char name[]);
+extern bool lockTimeout(int8_t mutex, uint32_t timeout);
+extern bool waitTimeout(int8_t semaphore, uint32_t timeout);
+extern bool queueSend(uint8_t queue, const void *msg, uint32_t timeout);
+extern bool queueReceive(uint8_t queue, void *msg, uint32_t timeout);
+extern uint32_t setEventFlags(uint8_t group, uint32_t flags);
+extern uint32_t waitEventFlags(uint8_t group, uint32_t mask, uint8_t options, uint32_t timeout);
+extern uint32_t serialWrite(const char str[], uint32_t len);
+extern uint32_t serialRead(char str[], uint32_t len);
+extern uint8_t serialWriteDma(const char str[], uint32_t len);
+extern bool notify(_fn fn, uint8_t action, uint32_t value);
+extern uint32_t notifyTake(bool clear, uint32_t timeout);
+extern void *poolGet(uint8_t pool);
+extern bool poolPut(uint8_t pool, void *block);
 
 void systickIsr(void);
 void pendSvIsr(void);
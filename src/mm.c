@@ -17,166 +17,365 @@
 #include "tm4c123gh6pm.h"
 #include "uart0.h"
 #include "mm.h"
-
-#define HeapBase512  0x20001000
-#define HeapBase1024 0x20004000
+#include "sp.h"
+
+// The heap is managed in 512B units numbered from the start of SRAM, so a
+// block of 2^k units is aligned to its own size exactly as the MPU wants.
+// Units 8-15 (region 2), 16-31 (regions 3-4) and 32-63 (regions 5-6) form
+// three buddy trees of 4K, 8K and 16K; units 0-7 are kernel memory and are
+// never free, which stops a tree from merging with anything outside it.
+#define SramBase 0x20000000
+#define HeapBase 0x20001000
 #define HeapLimit 0x20008000
-#define MaxAllocations 40
-
-typedef struct{
-    void* ptrAddress;
-    uint8_t blocksUsed;
-    uint16_t blocksSize;
-} HeapAllocation;
+#define UnitSize 512
+#define HeapUnits 64
+#define MaxOrder (HEAP_ORDERS - 1)  // 16K blocks
+#define FirstLargeUnit 32       // regions 5-6 have 1K subregions, so blocks there are 2 units or more
 
-HeapAllocation allocation[MaxAllocations];      //array to store the allocation info
+// RASR of the SRAM regions without their SRD bits
+//                    Execute Never   |  RW all access | Share & Cache |   size    |
+#define SRAM_4K_ATTR (NVIC_MPU_ATTR_XN | (0b011 << 24) | (0b110 << 16) | (0b01011 << 1) | NVIC_MPU_ATTR_ENABLE)
+#define SRAM_8K_ATTR (NVIC_MPU_ATTR_XN | (0b011 << 24) | (0b110 << 16) | (0b01100 << 1) | NVIC_MPU_ATTR_ENABLE)
 
 //Global variables
-uint64_t MemUse = 0;    //Index to track the usage of memory chunks
-uint8_t count = 0;      //Counter to track number of allocations
+uint64_t MemUse = 0;    //Units in use
+uint64_t FreeBlocks[MaxOrder + 1] = {0, 0, 0, 1ULL << 8, 1ULL << 16, 1ULL << 32};   //Free blocks of 2^order units, by first unit
+
+//Allocation info, indexed by the allocation's first unit
+uint8_t unitsUsed[HeapUnits];       //units in the allocation starting here, 0 if none starts here
+uint16_t blocksSize[HeapUnits];     //size of the allocation request
+
+//Running totals for getHeapStats()
+uint32_t BytesInUse = 0;
+uint32_t BytesRequested = 0;
+uint32_t PeakInUse = 0;
+uint16_t Allocations = 0;
+uint32_t Failures = 0;
 
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
 
-void StoreAllocation(void *addr, uint8_t blocks, uint16_t size)
+//Returns the unit starting at addr, or -1 if addr is not the start of a heap unit
+int8_t UnitIndex(void *addr)
 {
-    if (count < MaxAllocations)
+    uintptr_t address = (uintptr_t)addr;
+    if (address >= HeapBase && address < HeapLimit && (address % UnitSize) == 0)
+    {
+        return (address - SramBase) / UnitSize;
+    }
+    return -1;
+}
+
+//Returns the lowest unit of a non-zero bit map
+uint8_t LowestUnit(uint64_t map)
+{
+    map &= ~map + 1;
+    if ((uint32_t)map != 0)
+    {
+        return 31 - countLeadingZeros((uint32_t)map);
+    }
+    return 63 - countLeadingZeros((uint32_t)(map >> 32));
+}
+
+//Puts a free block back, merging it with its buddy for as long as the buddy is free too
+void ReleaseBlock(uint8_t unit, uint8_t order)
+{
+    while (order < MaxOrder)
+    {
+        uint8_t buddy = unit ^ (1 << order);
+        if ((FreeBlocks[order] & (1ULL << buddy)) == 0)
+        {
+            break;
+        }
+        FreeBlocks[order] &= ~(1ULL << buddy);
+        unit &= buddy;                      //the merged block starts at the lower of the two
+        order++;
+    }
+    FreeBlocks[order] |= 1ULL << unit;
+}
+
+// REQUIRED: add your malloc code here and update the SRD bits for the current thread
+// Buddy allocator: the smallest free block of at least the rounded-up size
+// is taken and split in halves, keeping the halves the request covers and
+// returning the others to the free lists. An allocation is therefore a run
+// of whole subregions (1 unit, or 2 in regions 5-6) that no other
+// allocation shares, and wastes less than one subregion. A 1536B stack
+// takes 3 units instead of a 2K block. Every step is bounded by MaxOrder.
+void * mallocFromHeap(uint32_t size_in_bytes)
+{
+    uint32_t units = (size_in_bytes + UnitSize - 1) / UnitSize;
+    uint8_t order = 0;
+    uint8_t unit;
+
+    if (units == 0)
+    {
+        units = 1;
+    }
+    if (units > (1UL << MaxOrder))
+    {
+        Failures++;
+        return 0;
+    }
+    while ((1UL << order) < units)
+    {
+        order++;
+    }
+    while (order <= MaxOrder && FreeBlocks[order] == 0)     //smallest free block that fits
+    {
+        order++;
+    }
+    if (order > MaxOrder)
     {
-        allocation[count].ptrAddress = addr;        //Points to start of the allocation
-        allocation[count].blocksUsed = blocks;      //count of the blocks allocated
-        allocation[count].blocksSize = size;        //size of the allocation request
-        count++;
+        Failures++;
+        return 0;
     }
-    else
+    unit = LowestUnit(FreeBlocks[order]);
+    FreeBlocks[order] &= ~(1ULL << unit);
+    if (unit >= FirstLargeUnit)
     {
-        putsUart0("Error: Maximum number of allocations reached.\n");
+        units = (units + 1) & ~1;           //whole 1K subregions
     }
+
+    uint8_t first = unit;
+    uint32_t remaining = units;
+    while ((1UL << order) > remaining)      //split until the kept halves cover the request exactly
+    {
+        order--;
+        if (remaining <= (1UL << order))
+        {
+            ReleaseBlock(unit + (1 << order), order);       //upper half is not needed
+        }
+        else
+        {
+            unit += 1 << order;                             //lower half is kept whole
+            remaining -= 1 << order;
+        }
+    }
+
+    MemUse |= ((1ULL << units) - 1) << first;
+    unitsUsed[first] = units;
+    blocksSize[first] = size_in_bytes;
+    BytesInUse += units * UnitSize;
+    BytesRequested += size_in_bytes;
+    Allocations++;
+    if (BytesInUse > PeakInUse)
+    {
+        PeakInUse = BytesInUse;
+    }
+    return (void*)(uintptr_t)(SramBase + first * UnitSize);
 }
 
-uint16_t SizeMatch(uint16_t size)
+// REQUIRED: add your free code here and update the SRD bits for the current thread
+// The allocation info is found from the address itself, so freeing takes
+// the same time however many allocations are live. Anything but the start
+// of a live allocation is ignored.
+void freeToHeap(void *pMemory)
 {
-    if (size <= 512)    //Size < 512 is considered as 512B.
+    int8_t unit = UnitIndex(pMemory);
+    uint8_t units;
+    uint8_t order;
+    if (unit < 0 || unitsUsed[unit] == 0)
     {
-        return 512;
+        return;
     }
-    else                //Size > 512 is considered as 1024B.
+    units = unitsUsed[unit];
+    MemUse &= ~(((1ULL << units) - 1) << unit);
+    BytesInUse -= units * UnitSize;
+    BytesRequested -= blocksSize[unit];
+    Allocations--;
+    unitsUsed[unit] = 0;
+    blocksSize[unit] = 0;
+
+    while (units > 0)                       //the run splits back into the aligned blocks it was cut from
     {
-        return 1024;
+        order = MaxOrder;
+        while ((unit & ((1 << order) - 1)) != 0 || (1 << order) > units)
+        {
+            order--;
+        }
+        ReleaseBlock(unit, order);
+        unit += 1 << order;
+        units -= 1 << order;
     }
 }
 
+// True if size bytes at p lie inside the heap (a task's stack or buffers
+// can only be there)
+bool isHeapMemory(const void *p, uint32_t size)
+{
+    uintptr_t address = (uintptr_t)p;
+    return (size != 0) && (address >= HeapBase) && (address < HeapLimit) && (size <= HeapLimit - address);
+}
 
-// REQUIRED: add your malloc code here and update the SRD bits for the current thread
-void * mallocFromHeap(uint32_t size_in_bytes)
+// Returns the size requested for an allocation, or 0 if pMemory is not one
+uint32_t allocationSize(void *pMemory)
 {
-    uint16_t RoundedSize = SizeMatch(size_in_bytes);
-    uint8_t TotalBlocks = RoundedSize == 512 ? 24 : 16;                             //Use 24 total blocks if 512B or else use 16 blocks
-    uint8_t BlocksNeeded = RoundedSize == 512 ? 1 : ((size_in_bytes + 1023)/1024);  //Use the value of 1 if just one block or use
-    if(RoundedSize == 512)
+    int8_t unit = UnitIndex(pMemory);
+    return (unit < 0) ? 0 : blocksSize[unit];
+}
+
+// The totals are kept up to date by mallocFromHeap() and freeToHeap(); the
+// free block counts and runs are read from the bit maps here, which takes a
+// fixed number of steps.
+void getHeapStats(heapStats *stats)
+{
+    uint64_t map;
+    uint32_t freeBytes = 0;
+    uint32_t run = 0;
+    uint8_t order, unit;
+
+    stats->heapBytes = HeapLimit - HeapBase;
+    stats->bytesInUse = BytesInUse;
+    stats->bytesRequested = BytesRequested;
+    stats->peakInUse = PeakInUse;
+    stats->allocations = Allocations;
+    stats->failures = Failures;
+    stats->largestFreeBlock = 0;
+    for (order = 0; order <= MaxOrder; order++)
     {
-        uint8_t blockIndex = 0;                                                     //There are 24 blocks of 512B : (3 regions * (8 subregions of 512B))
-        for(blockIndex = 0; blockIndex < TotalBlocks; blockIndex++)
+        stats->freeBlocks[order] = 0;
+        for (map = FreeBlocks[order]; map != 0; map &= map - 1)
         {
-            if((MemUse & (1ULL << blockIndex)) == 0)                                //Checks if block is free by using a bitmask to check the position of that bit
-            {
-                MemUse |= (1ULL << (blockIndex));                                   //Marks the block as used
-                void* BlockAddress = (void*)(HeapBase512 + (blockIndex * 512));     //Calculates the allocated block address
-                StoreAllocation(BlockAddress, 1, size_in_bytes);                    //Stores the allocation info in the struct
-                return BlockAddress;                                                //Returns the address and exits the function
-            }
+            stats->freeBlocks[order]++;
         }
+        if (stats->freeBlocks[order] != 0)
+        {
+            stats->largestFreeBlock = UnitSize << order;
+        }
+        freeBytes += (uint32_t)stats->freeBlocks[order] * (UnitSize << order);
+    }
 
-        //If 512B regions are full, check for space in the 1024B region [Edge case]
-        for(blockIndex = 0; blockIndex < 16; blockIndex++)                          //16 blocks of 1024B
+    stats->largestFreeRun = 0;
+    for (unit = (HeapBase - SramBase) / UnitSize; unit < HeapUnits; unit++)
+    {
+        run = (MemUse & (1ULL << unit)) ? 0 : run + UnitSize;
+        if (run > stats->largestFreeRun)
         {
-            if ((MemUse & (1ULL << (24 + blockIndex))) == 0)                        //Checks for free blocks at an offset of 24 blocks since
-            {                                                                       //first 24 blocks are for 512B allocations
-                MemUse |= (1ULL << (24 + blockIndex));                              //Marks the 1024B block as used
-                void* BlockAddress = (void*)(HeapBase1024 + (blockIndex * 1024));
-                StoreAllocation(BlockAddress, 1, size_in_bytes);                    //Store the allocation info
-                return BlockAddress;                                                //Return the allocated 1024B address for a 512B allocation
-            }
+            stats->largestFreeRun = run;
         }
     }
-    else
+    stats->fragmentation = (freeBytes == 0) ? 0 : 10000 - (uint32_t)(((uint64_t)stats->largestFreeBlock * 10000) / freeBytes);
+}
+
+// Block pools
+// A pool takes blocks * blockSize bytes from the heap in one allocation, so
+// its blocks sit in heap subregions the MPU can hand to tasks. Which blocks
+// are free is kept in a bit map in the pool record, in kernel memory, never
+// in the blocks themselves: a task still able to write a block it has put
+// back cannot steer the next getBlock(). A CLZ finds the lowest free block,
+// so getting and putting a block take a fixed number of steps. Each held
+// block records its owner, and only the owner may put it back, since MPU
+// subregions are too coarse to tell blocks apart. Callers serialise access.
+
+// Bit of block n in freeMap
+#define POOL_BIT(n) (0x80000000UL >> (n))
+
+bool createBlockPool(blockPool *pool, uint16_t blockSize, uint16_t blocks)
+{
+    blockSize = (blockSize + 7) & ~7;               //keeps every block 8-byte aligned
+    if (blockSize == 0 || blocks == 0 || blocks > MAX_POOL_BLOCKS)
+    {
+        return false;
+    }
+    pool->base = mallocFromHeap((uint32_t)blockSize * blocks);
+    if (pool->base == 0)
     {
-        uint8_t blockIndex = 0;
-        uint8_t i = 0;                                                      //There are 16 blocks of 1024B : (2 regions * (8 subregions of 1024B))
-        uint8_t j = 0;
-        for(blockIndex = 0; blockIndex < TotalBlocks; blockIndex++)
+        return false;
+    }
+    pool->blockSize = blockSize;
+    pool->blocks = blocks;
+    pool->freeCount = blocks;
+    pool->freeMap = (blocks == 32) ? 0xFFFFFFFF : ~(0xFFFFFFFFUL >> blocks);
+    return true;
+}
+
+// Returns the lowest free block, now held by owner, or 0 if the pool is empty
+void *getBlock(blockPool *pool, uint8_t owner)
+{
+    uint8_t n;
+    if (pool->freeMap == 0)
+    {
+        return 0;
+    }
+    n = countLeadingZeros(pool->freeMap);
+    pool->freeMap &= ~POOL_BIT(n);
+    pool->owner[n] = owner;
+    pool->freeCount--;
+    return pool->base + (uint32_t)n * pool->blockSize;
+}
+
+// Index of the block starting at address block, or -1 if there is none
+int8_t BlockIndex(blockPool *pool, void *block)
+{
+    uint32_t offset = (uint8_t*)block - pool->base;
+    if (pool->base == 0 || (uint8_t*)block < pool->base
+        || offset >= (uint32_t)pool->blockSize * pool->blocks || offset % pool->blockSize != 0)
+    {
+        return -1;
+    }
+    return offset / pool->blockSize;
+}
+
+// Returns a block to its pool. Fails for an address that is not the start
+// of one of the pool's blocks, for a block that is already free, so a
+// second put cannot hand the same block out twice, and for a block held by
+// someone other than owner.
+bool putBlock(blockPool *pool, void *block, uint8_t owner)
+{
+    int8_t n = BlockIndex(pool, block);
+    if (n < 0 || (pool->freeMap & POOL_BIT(n)) != 0 || pool->owner[n] != owner)
+    {
+        return false;
+    }
+    pool->freeMap |= POOL_BIT(n);
+    pool->freeCount++;
+    return true;
+}
+
+// Hands a held block to a new owner; false if block is not a held block
+bool setBlockOwner(blockPool *pool, void *block, uint8_t owner)
+{
+    int8_t n = BlockIndex(pool, block);
+    if (n < 0 || (pool->freeMap & POOL_BIT(n)) != 0)
+    {
+        return false;
+    }
+    pool->owner[n] = owner;
+    return true;
+}
+
+// Returns every block owner still holds, for a task that is killed
+void putOwnedBlocks(blockPool *pool, uint8_t owner)
+{
+    uint16_t n;
+    for (n = 0; n < pool->blocks; n++)
+    {
+        if ((pool->freeMap & POOL_BIT(n)) == 0 && pool->owner[n] == owner)
         {
-            uint8_t found = 1;
-            for(i = 0; i < BlocksNeeded; i++)
-            {
-                uint32_t currAddress = HeapBase1024 + ((blockIndex + i) * 1024);
-                if(currAddress >= HeapLimit)
-                {
-                    return NULL;
-                }
-
-                if(MemUse & (1ULL << (24 + blockIndex + i)))                      //Offset of 24 cuz of 512B regions
-                {
-                    found = 0;
-                    break;
-                }
-            }
-            if(found)
-            {
-                for(j = 0; j < BlocksNeeded; j++)
-                {
-                    MemUse |= (1ULL << (24 + (blockIndex + j)));                       //Marks the block as used
-                }
-                void* BlockAddress = (void*)(HeapBase1024 + (blockIndex * 1024));   //Returns the allocated block address
-                StoreAllocation(BlockAddress, BlocksNeeded, size_in_bytes);         //
-                return BlockAddress;
-            }
+            pool->freeMap |= POOL_BIT(n);
+            pool->freeCount++;
         }
     }
-    return 0;
 }
 
-// REQUIRED: add your free code here and update the SRD bits for the current thread
-void freeToHeap(void *pMemory)
+// True if another block of the pool that is still held shares an MPU
+// subregion with this one, so access to the subregion cannot be taken away
+bool blockWindowHeld(blockPool *pool, void *block)
 {
-    // Search the allocation array for the given pointer
-    uint8_t i = 0;
-    for (i = 0; i < count; i++)
+    uint64_t window = sramWindowMask(block, pool->blockSize);
+    uint8_t *other;
+    uint16_t n;
+    for (n = 0; n < pool->blocks; n++)
     {
-        if (allocation[i].ptrAddress == pMemory)  // Found the matching allocation
+        other = pool->base + (uint32_t)n * pool->blockSize;
+        if (other != block && (pool->freeMap & POOL_BIT(n)) == 0
+            && (sramWindowMask((uint32_t*)other, pool->blockSize) & window) != 0)
         {
-            // Determine whether it's in the 512B or 1024B region
-            if ((uintptr_t)pMemory >= HeapBase512 && (uintptr_t)pMemory < HeapBase1024)
-            {
-                // Free the blocks in the 512B region
-                uint8_t j = 0;
-                for (j = 0; j < allocation[i].blocksUsed; j++)
-                {
-                    uint16_t BlockIndex = ((uintptr_t)pMemory - HeapBase512) / 512;
-                    MemUse &= ~(1ULL << (BlockIndex + j));  // Mark each block as free
-                }
-            }
-            else if ((uintptr_t)pMemory >= HeapBase1024 && (uintptr_t)pMemory < HeapLimit)
-            {
-                // Free the blocks in the 1024B region
-                uint8_t j = 0;
-                for (j = 0; j < allocation[i].blocksUsed; j++)
-                {
-                    uint16_t BlockIndex = ((uintptr_t)pMemory - HeapBase1024) / 1024;
-                    MemUse &= ~(1ULL << (24 + BlockIndex + j));  // Mark each block as free
-                }
-            }
-
-            // Reset the allocation entry
-            allocation[i].ptrAddress = NULL;
-            allocation[i].blocksUsed = 0;
-            allocation[i].blocksSize = 0;
-
-            count--;
-            return;
+            return true;
         }
     }
-//    putsUart0("\nInvalid pointer passed.");
+    return false;
 }
 
 // REQUIRED: include your solution from the mini project
@@ -241,8 +440,10 @@ uint64_t createNoSramAccessMask(void)
     //40 bits = 40 1s
 }
 
-void addSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_in_bytes)
+// Returns the SRD bits of the subregions that hold a block of heap memory
+uint64_t sramWindowMask(uint32_t *baseAdd, uint32_t size_in_bytes)
 {
+    uint64_t windowMask = 0;
     int SizeLeft = size_in_bytes;
     uint32_t currentAddress = (uintptr_t)baseAdd;
     uint8_t i = 0;
@@ -286,6 +487,7 @@ void addSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_
         else
         {
             putsUart0("error...\n");
+            break;
         }
 
         //StartSR gets the index to start from.
@@ -308,7 +510,7 @@ void addSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_
         //Depending on the start index, srd bits are enabled.
         for (i = StartSR; i <= EndSR; i++)
         {
-            *srdBitMask &= ~(1ULL << (regionOffset + i));  // Set bit to 0
+            windowMask |= (1ULL << (regionOffset + i));
         }
 
         //Calculation for remaining size.
@@ -316,36 +518,52 @@ void addSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_
         SizeLeft -= SizeDone;
         currentAddress += SizeDone;
     }
+    return windowMask;
 }
 
-void applySramAccessMask(uint64_t srdBitMask)
+void addSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_in_bytes)
 {
-    //Extract each 8 bits of the SRD Bit mask and apply it to each corresponding region.
-    uint8_t i = 0;
-    for (i = 2; i < 7; i++)
-    {
-        NVIC_MPU_NUMBER_R = i;
-
-        uint8_t shiftAmount = (i - 2) * 8;
-        uint64_t regionMask = (srdBitMask >> shiftAmount) & 0xFF;
+    *srdBitMask &= ~sramWindowMask(baseAdd, size_in_bytes);    // Set bits to 0
+}
 
-        //              apply to SRD region | preserves other MPU_ATTR settings
-        NVIC_MPU_ATTR_R = (regionMask << 8) | (NVIC_MPU_ATTR_R & 0xFFFF00FF);
-    }
+void removeSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_in_bytes)
+{
+    *srdBitMask |= sramWindowMask(baseAdd, size_in_bytes);     // Set bits to 1
 }
 
-uint32_t RoundUp(uint32_t Bytes)
+// RBAR values of regions 2-6. Each carries the region number and VALID
+// bit, so applySramRegions() can write all five regions through the alias
+// registers without touching MPU_NUMBER. They do not depend on the mask.
+const uint32_t sramRegionBase[SRAM_REGIONS] =
 {
-    if(Bytes == 512)
-    {
-        return 512;
-    }
-    else if(Bytes == 1024)
-    {
-        return 1024;
-    }
-    else
+    0x20001000 | NVIC_MPU_BASE_VALID | 2,
+    0x20002000 | NVIC_MPU_BASE_VALID | 3,
+    0x20003000 | NVIC_MPU_BASE_VALID | 4,
+    0x20004000 | NVIC_MPU_BASE_VALID | 5,
+    0x20006000 | NVIC_MPU_BASE_VALID | 6
+};
+
+// Turns an SRD bit mask into the RASR values of regions 2-6
+void buildSramRegions(uint32_t attr[], uint64_t srdBitMask)
+{
+    static const uint32_t size[SRAM_REGIONS] = {SRAM_4K_ATTR, SRAM_4K_ATTR, SRAM_4K_ATTR, SRAM_8K_ATTR, SRAM_8K_ATTR};
+    uint8_t i = 0;
+    for (i = 0; i < SRAM_REGIONS; i++)
     {
-        return ((Bytes + 1023) / 1024) * 1024;
+        //Extract each 8 bits of the SRD Bit mask and apply it to each corresponding region.
+        uint32_t regionMask = (uint32_t)(srdBitMask >> (i * 8)) & 0xFF;
+        attr[i] = size[i] | (regionMask << 8);
     }
 }
+
+void applySramAccessMask(uint64_t srdBitMask)
+{
+    uint32_t attr[SRAM_REGIONS];
+    buildSramRegions(attr, srdBitMask);
+    applySramRegions(sramRegionBase, attr);
+}
+
+uint32_t RoundUp(uint32_t Bytes)         //bytes an allocation of Bytes is sure to span
+{
+    return ((Bytes + UnitSize - 1) / UnitSize) * UnitSize;
+}
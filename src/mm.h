@@ -11,7 +11,40 @@
 #ifndef MM_H_
 #define MM_H_
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #define NUM_SRAM_REGIONS 4
+#define SRAM_REGIONS 5            // MPU regions 2-6, over the heap
+#define HEAP_ORDERS 6             // buddy block sizes, 512B << 0 to 512B << 5
+#define MAX_POOL_BLOCKS 32        // blocks per pool, one bit each in freeMap
+#define POOL_NO_OWNER 0xFF        // block held by an interrupt handler or in a queue (NO_TASK)
+
+// heap statistics reported by the meminfo command
+typedef struct _heapStats
+{
+    uint32_t heapBytes;
+    uint32_t bytesInUse;          // heap taken by allocations (whole subregions)
+    uint32_t bytesRequested;      // sum of the sizes asked for
+    uint32_t peakInUse;           // highest bytesInUse since reset
+    uint16_t allocations;         // live allocations
+    uint16_t freeBlocks[HEAP_ORDERS]; // free buddy blocks of each size
+    uint32_t largestFreeBlock;    // largest request that can still succeed
+    uint32_t largestFreeRun;      // longest stretch of free memory, across buddy trees
+    uint16_t fragmentation;       // hundredths of a percent of free memory outside the largest free block
+    uint32_t failures;            // mallocFromHeap() calls that returned 0
+} heapStats;
+
+// fixed-size block pool carved out of one heap allocation
+typedef struct _blockPool
+{
+    uint8_t *base;                // first block, 0 if the pool is not created
+    uint16_t blockSize;           // rounded up to a multiple of 8
+    uint16_t blocks;
+    uint16_t freeCount;
+    uint32_t freeMap;             // bit (31 - n) is set while block n is free
+    uint8_t owner[MAX_POOL_BLOCKS]; // task holding each block that is not free
+} blockPool;
 
 //-----------------------------------------------------------------------------
 // Subroutines
@@ -19,12 +52,25 @@
 
 void * mallocFromHeap(uint32_t size_in_bytes);
 void freeToHeap(void *pMemory);
+uint32_t allocationSize(void *pMemory);
+bool isHeapMemory(const void *p, uint32_t size);
+void getHeapStats(heapStats *stats);
+bool createBlockPool(blockPool *pool, uint16_t blockSize, uint16_t blocks);
+void *getBlock(blockPool *pool, uint8_t owner);
+bool putBlock(blockPool *pool, void *block, uint8_t owner);
+bool setBlockOwner(blockPool *pool, void *block, uint8_t owner);
+void putOwnedBlocks(blockPool *pool, uint8_t owner);
+bool blockWindowHeld(blockPool *pool, void *block);
 
 void allowFlashAccess(void);
 void allowPeripheralAccess(void);
 void setupSramAccess(void);
 uint64_t createNoSramAccessMask(void);
+uint64_t sramWindowMask(uint32_t *baseAdd, uint32_t size_in_bytes);
 void addSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_in_bytes);
+void removeSramAccessWindow(uint64_t *srdBitMask, uint32_t *baseAdd, uint32_t size_in_bytes);
+extern const uint32_t sramRegionBase[SRAM_REGIONS];
+void buildSramRegions(uint32_t attr[], uint64_t srdBitMask);
 void applySramAccessMask(uint64_t srdBitMask);
 uint32_t RoundUp(uint32_t Bytes);
 
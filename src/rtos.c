@@ -45,6 +45,8 @@
 // Main
 //-----------------------------------------------------------------------------
 
+// The benchmark image (bench.c) provides its own main()
+#ifndef RTOS_BENCHMARK
 int main(void)
 {
     bool ok;
@@ -63,17 +65,18 @@ int main(void)
     setUart0BaudRate(115200, 40e6);
 
      // Initialize mutexes and semaphores
-    initMutex(resource);
-    initSemaphore(keyPressed, 1);
-    initSemaphore(keyReleased, 0);
-    initSemaphore(flashReq, 5);
+    initMutex(resource, QUEUE_PRIO);
+    initSemaphore(keyPressed, 1, QUEUE_PRIO);
+    initSemaphore(keyReleased, 0, QUEUE_PRIO);
+    initSemaphore(flashReq, 5, QUEUE_PRIO);
+    initEventGroup(uart0Events);
 
     // Add required idle process at lowest priority
     ok = createThread(idle, "Idle", 15, 512);
 
     // Add other processes
     ok &= createThread(lengthyFn, "LengthyFn", 12, 1024);
-    ok &= createThread(flash4Hz, "Flash4Hz", 8, 512);
+    ok &= createPeriodicThread(flash4Hz, "Flash4Hz", 8, 512, 125, 125);
     ok &= createThread(oneshot, "OneShot", 4, 1536);
     ok &= createThread(readKeys, "ReadKeys", 12, 1024);
     ok &= createThread(debounce, "Debounce", 12, 1024);
@@ -91,3 +94,4 @@ int main(void)
     else
         while(true);
 }
+#endif
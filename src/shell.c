@@ -31,14 +31,28 @@
 // Subroutines
 //-----------------------------------------------------------------------------
 
+// Prints a value in hundredths of a percent as x.yy%
+void putsPercent(UART_BUFFER *out, uint32_t hundredths)
+{
+    char info[12];
+    IntToStr(hundredths / 100, info);
+    putsBufferUart0(out, info);
+    putcBufferUart0(out, '.');
+    putcBufferUart0(out, '0' + (hundredths / 10) % 10);
+    putcBufferUart0(out, '0' + hundredths % 10);
+    putcBufferUart0(out, '%');
+}
+
 void meminfo()
 {
+    UART_BUFFER out;                //table is sent by DMA in blocks
+    out.count = 0;
     ExtractTCB showTCB[MAX_TASKS];
     getTCBinfo(showTCB);
 
-    putsUart0("-------------------------------------------\n");
-    putsUart0("| Prio | Process Name |  Address   | Size  \n");
-    putsUart0("-------------------------------------------\n");
+    putsBufferUart0(&out, "-------------------------------------------\n");
+    putsBufferUart0(&out, "| Prio | Process Name |  Address   | Size  \n");
+    putsBufferUart0(&out, "-------------------------------------------\n");
 
     uint8_t i,j = 0;
     char info[15];
@@ -52,48 +66,148 @@ void meminfo()
             }
 
 
-            putsUart0("|  ");
+            putsBufferUart0(&out, "|  ");
             IntToStr(showTCB[i].priority,info);
-            putsUart0(info);
+            putsBufferUart0(&out, info);
             for (j = StringLen(info); j < 4; j++)
             {
-                putsUart0(" ");
+                putsBufferUart0(&out, " ");
             }
             //Process name
-            putsUart0("| ");
-            putsUart0(showTCB[i].name);
+            putsBufferUart0(&out, "| ");
+            putsBufferUart0(&out, showTCB[i].name);
             for (j = StringLen(showTCB[i].name); j < 11; j++)
             {
-                putsUart0(" ");
+                putsBufferUart0(&out, " ");
             }
 
             //Base Address
-            putsUart0("  | ");
+            putsBufferUart0(&out, "  | ");
             IntToHex((uint32_t)showTCB[i].BaseAddr, info);
-            putsUart0("0x");
-            putsUart0(info);
+            putsBufferUart0(&out, "0x");
+            putsBufferUart0(&out, info);
 
             //Thread Size
-            putsUart0(" | ");
+            putsBufferUart0(&out, " | ");
             IntToStr(showTCB[i].ThreadSize, info);
-            putsUart0(info);
+            putsBufferUart0(&out, info);
             for (j = StringLen(info); j < 5; j++)
             {
-                putsUart0(" ");
+                putsBufferUart0(&out, " ");
             }
-            putsUart0("B\n");
+            putsBufferUart0(&out, "B\n");
         }
     }
+
+    //HEAP
+    heapStats heap;
+    getHeapInfo(&heap);
+    putsBufferUart0(&out, "-------------------------------------------\n");
+    putsBufferUart0(&out, "Heap in use:        ");
+    IntToStr(heap.bytesInUse, info);
+    putsBufferUart0(&out, info);
+    putsBufferUart0(&out, "/");
+    IntToStr(heap.heapBytes, info);
+    putsBufferUart0(&out, info);
+    putsBufferUart0(&out, "B (");
+    putsPercent(&out, (uint32_t)(((uint64_t)heap.bytesInUse * 10000) / heap.heapBytes));
+    putsBufferUart0(&out, ")\nPeak in use:        ");
+    IntToStr(heap.peakInUse, info);
+    putsBufferUart0(&out, info);
+    putsBufferUart0(&out, "B\nRequested:          ");
+    IntToStr(heap.bytesRequested, info);
+    putsBufferUart0(&out, info);
+    putsBufferUart0(&out, "B in ");
+    IntToStr(heap.allocations, info);
+    putsBufferUart0(&out, info);
+    putsBufferUart0(&out, " allocations\nFree blocks:       ");
+    for(i = 0; i < HEAP_ORDERS; i++)
+    {
+        putsBufferUart0(&out, " ");
+        IntToStr(512 << i, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "Bx");
+        IntToStr(heap.freeBlocks[i], info);
+        putsBufferUart0(&out, info);
+    }
+    putsBufferUart0(&out, "\nLargest free block: ");
+    IntToStr(heap.largestFreeBlock, info);
+    putsBufferUart0(&out, info);
+    putsBufferUart0(&out, "B (run of ");
+    IntToStr(heap.largestFreeRun, info);
+    putsBufferUart0(&out, info);
+    putsBufferUart0(&out, "B)\nFragmentation:      ");
+    putsPercent(&out, heap.fragmentation);
+    putsBufferUart0(&out, "\nFailed allocations: ");
+    IntToStr(heap.failures, info);
+    putsBufferUart0(&out, info);
+    putsBufferUart0(&out, "\n");
+
+    flushBufferUart0(&out);
+}
+
+// Pads a table column with spaces to the given width
+void putsColumn(UART_BUFFER *out, char *str, uint8_t width)
+{
+    uint8_t j;
+    putsBufferUart0(out, str);
+    for (j = StringLen(str); j < width; j++)
+    {
+        putsBufferUart0(out, " ");
+    }
+}
+
+// Stack use of each thread. Used is the depth at the thread's last switch,
+// peak the deepest word the idle scan has found overwritten. The suggested
+// size adds a quarter of the peak as headroom and rounds up to the 512-byte
+// heap unit.
+void stack()
+{
+    UART_BUFFER out;
+    out.count = 0;
+    ExtractTCB showTCB[MAX_TASKS];
+    getTCBinfo(showTCB);
+
+    putsBufferUart0(&out, "------------------------------------------------\n");
+    putsBufferUart0(&out, "| Process Name | Size  | Used  | Peak  | Suggest\n");
+    putsBufferUart0(&out, "------------------------------------------------\n");
+
+    uint8_t i;
+    char info[15];
+    for(i = 0; i < MAX_TASKS && showTCB[i].ThreadSize != 0; i++)
+    {
+        uint32_t suggested = (showTCB[i].stackPeak + showTCB[i].stackPeak / 4 + 511) / 512 * 512;
+
+        putsBufferUart0(&out, "| ");
+        putsColumn(&out, showTCB[i].name, 13);
+        putsBufferUart0(&out, "| ");
+        IntToStr(showTCB[i].ThreadSize, info);
+        putsColumn(&out, info, 6);
+        putsBufferUart0(&out, "| ");
+        IntToStr(showTCB[i].stackUsed, info);
+        putsColumn(&out, info, 6);
+        putsBufferUart0(&out, "| ");
+        IntToStr(showTCB[i].stackPeak, info);
+        putsColumn(&out, info, 6);
+        putsBufferUart0(&out, "| ");
+        IntToStr(suggested, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "\n");
+    }
+
+    flushBufferUart0(&out);
 }
 
 void ps()
 {
+    UART_BUFFER out;                //table is sent by DMA in blocks
+    out.count = 0;
     ExtractTCB showTCB[MAX_TASKS];
     getTCBinfo(showTCB);
 
-    putsUart0("--------------------------------------------------------------------\n");
-    putsUart0("|  PID  | Process Name |  CPU%  |        State         | Blocked By  \n");
-    putsUart0("--------------------------------------------------------------------\n");
+    putsBufferUart0(&out, "--------------------------------------------------------------------\n");
+    putsBufferUart0(&out, "|  PID  | Process Name |  CPU%  |        State         | Blocked By  \n");
+    putsBufferUart0(&out, "--------------------------------------------------------------------\n");
 
     uint8_t i,j,k = 0;
     char info[15];
@@ -110,49 +224,49 @@ void ps()
         }
 
         //PID
-        putsUart0("| ");
+        putsBufferUart0(&out, "| ");
         IntToStr(showTCB[i].pid, info);
-        putsUart0(info);
+        putsBufferUart0(&out, info);
         for(j = StringLen(info); j < 6; j++)
         {
-            putsUart0(" ");
+            putsBufferUart0(&out, " ");
         }
 
         //PROCESS NAME
-        putsUart0("| ");
-        putsUart0(showTCB[i].name);
+        putsBufferUart0(&out, "| ");
+        putsBufferUart0(&out, showTCB[i].name);
         for(j = StringLen(showTCB[i].name); j < 10; j++)
         {
-            putsUart0(" ");
+            putsBufferUart0(&out, " ");
         }
-        putsUart0("   | ");
+        putsBufferUart0(&out, "   | ");
 
         //CPU TIME
         if(showTCB[i].CPU_TIME == 0)
         {
-            putsUart0("0.00");
-            putsUart0("% ");   //For cpu time - change later
+            putsBufferUart0(&out, "0.00");
+            putsBufferUart0(&out, "% ");   //For cpu time - change later
 
             for(j = StringLen(info); j < 6; j++)
             {
-                putsUart0(" ");
+                putsBufferUart0(&out, " ");
             }
-            putsUart0("|");
+            putsBufferUart0(&out, "|");
 
         }
         else
         {
             IntToStr(showTCB[i].CPU_TIME, info);
             DecimalPlacer(info);
-            putsUart0(info);
+            putsBufferUart0(&out, info);
 
-            putsUart0("% ");   //For cpu time - change later
+            putsBufferUart0(&out, "% ");   //For cpu time - change later
 
             for(j = StringLen(info); j < 5; j++)
             {
-                putsUart0(" ");
+                putsBufferUart0(&out, " ");
             }
-            putsUart0("|");
+            putsBufferUart0(&out, "|");
 
         }
 
@@ -175,120 +289,301 @@ void ps()
         case 5:
             CurrentState = "BLOCKED BY SEMAPHORE";
             break;
+        case 6:
+            CurrentState = "BLOCKED ON SEND";
+            break;
+        case 7:
+            CurrentState = "BLOCKED ON RECEIVE";
+            break;
+        case 8:
+            CurrentState = "BLOCKED BY EVENTS";
+            break;
+        case 9:
+            CurrentState = "WAITING NOTIFY";
+            break;
         }
-        putsUart0(CurrentState);
+        putsBufferUart0(&out, CurrentState);
         for (j = StringLen(CurrentState); j < 20; j++)
         {
-            putsUart0(" ");
+            putsBufferUart0(&out, " ");
         }
-        putsUart0(" | ");
+        putsBufferUart0(&out, " | ");
 
         //BLOCKED BY
         if(CurrentState == "BLOCKED BY MUTEX")
         {
-            putsUart0(showTCB[showTCB[i].LockedBy + k].name);
+            putsBufferUart0(&out, showTCB[showTCB[i].LockedBy + k].name);
+        }
+        putsBufferUart0(&out, "\n");
+    }
+
+    //CPU SUMMARY
+    ExtractCpu cpu;
+    getCpuInfo(&cpu);
+    putsBufferUart0(&out, "--------------------------------------------------------------------\n");
+    putsBufferUart0(&out, "Idle: ");
+    putsPercent(&out, cpu.idle);
+    putsBufferUart0(&out, "   Load average (1s/5s/15s): ");
+    putsPercent(&out, cpu.load1);
+    putsBufferUart0(&out, " ");
+    putsPercent(&out, cpu.load5);
+    putsBufferUart0(&out, " ");
+    putsPercent(&out, cpu.load15);
+    putsBufferUart0(&out, "   Window: ");
+    IntToStr(cpu.windowMs, info);
+    putsBufferUart0(&out, info);
+    putsBufferUart0(&out, "ms\n");
+
+    //FPU CONTEXTS
+    bool fpu = false;
+    for(i = 0; i < MAX_TASKS && showTCB[i].ThreadSize != 0; i++)
+    {
+        if(showTCB[i].fpuUsed)
+        {
+            putsBufferUart0(&out, fpu ? " " : "FPU context: ");
+            putsBufferUart0(&out, showTCB[i].name);
+            fpu = true;
+        }
+    }
+    if(fpu)
+    {
+        putsBufferUart0(&out, "\n");
+    }
+
+    //PERIODIC THREADS
+    bool header = false;
+    for(i = 0; i < MAX_TASKS && showTCB[i].ThreadSize != 0; i++)
+    {
+        if(showTCB[i].period == 0)
+        {
+            continue;
+        }
+        if(!header)
+        {
+            header = true;
+            putsBufferUart0(&out, "\n--------------------------------------------------------------------\n");
+            putsBufferUart0(&out, "| Process Name | Period | Misses | Jitter Min | Jitter Avg | Jitter Max\n");
+            putsBufferUart0(&out, "--------------------------------------------------------------------\n");
+        }
+
+        putsBufferUart0(&out, "| ");
+        putsBufferUart0(&out, showTCB[i].name);
+        for(j = StringLen(showTCB[i].name); j < 13; j++)
+        {
+            putsBufferUart0(&out, " ");
+        }
+
+        putsBufferUart0(&out, "| ");
+        IntToStr(showTCB[i].period, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "ms");
+        for(j = StringLen(info); j < 5; j++)
+        {
+            putsBufferUart0(&out, " ");
+        }
+
+        putsBufferUart0(&out, "| ");
+        IntToStr(showTCB[i].deadlineMisses, info);
+        putsBufferUart0(&out, info);
+        for(j = StringLen(info); j < 7; j++)
+        {
+            putsBufferUart0(&out, " ");
+        }
+
+        putsBufferUart0(&out, "| ");
+        IntToStr(showTCB[i].jitterMin, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "us");
+        for(j = StringLen(info); j < 9; j++)
+        {
+            putsBufferUart0(&out, " ");
         }
-        putsUart0("\n");
+
+        putsBufferUart0(&out, "| ");
+        IntToStr(showTCB[i].jitterMean, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "us");
+        for(j = StringLen(info); j < 9; j++)
+        {
+            putsBufferUart0(&out, " ");
+        }
+
+        putsBufferUart0(&out, "| ");
+        IntToStr(showTCB[i].jitterMax, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "us\n");
+    }
+
+    flushBufferUart0(&out);
+}
+
+// Prints a wait queue as "[n] name" lines, or "[0] --" if it is empty
+void putsQueue(UART_BUFFER *out, char names[][20], uint8_t queue[], uint8_t size, char indent[])
+{
+    char info[4];
+    uint8_t k = 0;
+    if(size == 0)
+    {
+        putsBufferUart0(out, "[0] --\n");
+    }
+    for(k = 0; k < size && k < MAX_TASKS; k++)
+    {
+        if(k > 0)
+        {
+            putsBufferUart0(out, indent);
+        }
+        putsBufferUart0(out, "[");
+        IntToStr(k, info);
+        putsBufferUart0(out, info);
+        putsBufferUart0(out, "] ");
+        putsBufferUart0(out, names[queue[k]]);
+        putsBufferUart0(out, "\n");
     }
 }
 
 void ipcs()
 {
-    ExtractMutexSema Status[4];
+    UART_BUFFER out;                //table is sent by DMA in blocks
+    out.count = 0;
+    ExtractMutexSema Status[MAX_MUTEXES + MAX_SEMAPHORES];
     getMutexSemaInfo(Status);
 
     char info[20];
     char proc_list[10][20] = {"Idle", "LengthyFn", "Flash4Hz", "OneShot", "ReadKeys", "Debounce", "Important", "Uncoop", "Errant", "Shell"};
     char sema_list[3][12] = {"keyPressed","keyReleased","flashReq"};
 
-    putsUart0("\n--------------------Mutex Status--------------------\n\n");
+    putsBufferUart0(&out, "\n--------------------Mutex Status--------------------\n\n");
     if(Status[0].lock == 1)
     {
-        putsUart0("Resource locked By:   ");
-        putsUart0(proc_list[Status[0].MutexLockedBy]);
+        putsBufferUart0(&out, "Resource locked By:   ");
+        putsBufferUart0(&out, proc_list[Status[0].MutexLockedBy]);
 
-        putsUart0("\nMutex Queue Size:     ");
+        putsBufferUart0(&out, "\nMutex Queue Size:     ");
         IntToStr(Status[0].MutexQueueSize, info);
-        putsUart0(info);
+        putsBufferUart0(&out, info);
 
-        putsUart0("\nMutex Queue:      [0] ");
-        if((Status[0].MutexProcessQueue[0] == 0) && (Status[0].MutexProcessQueue[1] == 0))
-        {
-            putsUart0("-- \n                  [1] --\n");
-        }
-        else if((Status[0].MutexProcessQueue[0] > 0) && (Status[0].MutexProcessQueue[1] == 0))
-        {
-            putsUart0(proc_list[Status[0].MutexProcessQueue[0]]);
-            putsUart0("\n                  [1] --");
-        }
-        else
-        {
-            putsUart0(proc_list[Status[0].MutexProcessQueue[0]]);
-            putsUart0("\n                  [1] ");
-            putsUart0(proc_list[Status[0].MutexProcessQueue[1]]);
-        }
+        putsBufferUart0(&out, "\nMutex Queue:      ");
+        putsQueue(&out, proc_list, Status[0].MutexProcessQueue, Status[0].MutexQueueSize, "                  ");
     }
     else
     {
-        putsUart0("All mutexes are free.\n");
+        putsBufferUart0(&out, "All mutexes are free.\n");
+    }
+
+    putsBufferUart0(&out, "\nWorst-case Wait:     ");
+    IntToStr(Status[0].MutexMaxBlocked, info);
+    putsBufferUart0(&out, info);
+    putsBufferUart0(&out, " ms");
+    if(Status[0].MutexMaxBlocked > 0)
+    {
+        putsBufferUart0(&out, " (");
+        putsBufferUart0(&out, proc_list[Status[0].MutexMaxBlockedTask]);
+        putsBufferUart0(&out, ")");
     }
+    putsBufferUart0(&out, "\n");
 
-    putsUart0("\n\n\n------------------Semaphore Status------------------\n\n");
+    putsBufferUart0(&out, "\n\n\n------------------Semaphore Status------------------\n\n");
 
     uint8_t i = 0;
     for(i = 1; i < 4; i++)
     {
-        putsUart0("[");
+        putsBufferUart0(&out, "[");
         IntToStr(i-1, info);
-        putsUart0(info);
-        putsUart0("]");
-        putsUart0(sema_list[i-1]);
-        putsUart0(":");
-
-        if(Status[i].SemaQueue[0] > 0)
-        {
-            putsUart0("\tResource Counts:  \t");
-            IntToStr(Status[i].SemaCount, info);
-            putsUart0(info);
-            putsUart0("\n");
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "]");
+        putsBufferUart0(&out, sema_list[i-1]);
+        putsBufferUart0(&out, ":");
+
+        putsBufferUart0(&out, "\tResource Counts:  \t");
+        IntToStr(Status[i].SemaCount, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "\n");
+
+        putsBufferUart0(&out, "\t\tSemaphore Queue Size:\t");
+        IntToStr(Status[i].SemaQueueSize, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "\n");
+
+        putsBufferUart0(&out, "\t\tSemaphore Queue:\t");
+        putsQueue(&out, proc_list, Status[i].SemaQueue, Status[i].SemaQueueSize, "\t\t\t\t\t");
+        putsBufferUart0(&out, "\n");
+    }
 
-            putsUart0("\t\tSemaphore Queue Size:  \t");
-            IntToStr(Status[i].SemaQueueSize, info);
-            putsUart0(info);
-            putsUart0("\n");
+    ExtractQueue Queues[MAX_QUEUES];
+    getQueueInfo(Queues);
+    bool any = false;
 
-            putsUart0("\t\tSemaphore Queue:\t[0] ");
-            if(Status[i].SemaQueue[1] == 0)
-            {
-                putsUart0(proc_list[Status[i].SemaQueue[0]]);
-                putsUart0("\n\t\t\t\t\t[1] --");
-            }
-            else
-            {
-                putsUart0(proc_list[Status[i].MutexProcessQueue[0]]);
-                putsUart0("\n\t\t\t\t\t[1] ");
-                putsUart0(proc_list[Status[i].MutexProcessQueue[1]]);
-            }
-            putsUart0("\n\n");
-        }
-        else
+    putsBufferUart0(&out, "\n----------------Message Queue Status----------------\n\n");
+    for(i = 0; i < MAX_QUEUES; i++)
+    {
+        if(Queues[i].depth == 0)
         {
-            putsUart0("\tResource Counts:  \t");
-            IntToStr(Status[i].SemaCount, info);
-            putsUart0(info);
-            putsUart0("\n");
+            continue;
+        }
+        any = true;
+        putsBufferUart0(&out, "[");
+        IntToStr(i, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "]");
+        putsBufferUart0(&out, Queues[i].mode == QUEUE_ZERO_COPY ? "zero-copy" : "copy ");
+        putsBufferUart0(&out, ":\tMessages:\t\t");
+        IntToStr(Queues[i].count, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "/");
+        IntToStr(Queues[i].depth, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, " x ");
+        IntToStr(Queues[i].msgSize, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "B\n");
+
+        putsBufferUart0(&out, "\t\tHigh-water Mark:\t");
+        IntToStr(Queues[i].maxCount, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "\n");
+
+        putsBufferUart0(&out, "\t\tSenders/Receivers:\t");
+        IntToStr(Queues[i].sendersWaiting, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "/");
+        IntToStr(Queues[i].receiversWaiting, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, " waiting\n\n");
+    }
+    if(!any)
+    {
+        putsBufferUart0(&out, "No message queues.\n");
+    }
 
-            putsUart0("\t\tSemaphore Queue Size:\t");
-            IntToStr(Status[i].SemaQueueSize, info);
-            putsUart0(info);
-            putsUart0("\n");
+    ExtractEvents Events[MAX_EVENT_GROUPS];
+    getEventInfo(Events);
+    any = false;
 
-            putsUart0("\t\tSemaphore Queue:\t[0]");
-            putsUart0(" -- \n\t\t\t\t\t[1] --\n");
-            putsUart0("\n");
+    putsBufferUart0(&out, "\n-----------------Event Flag Status------------------\n\n");
+    for(i = 0; i < MAX_EVENT_GROUPS; i++)
+    {
+        if(!Events[i].used)
+        {
+            continue;
         }
+        any = true;
+        putsBufferUart0(&out, "[");
+        IntToStr(i, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "]:\tFlags:\t\t\t0x");
+        IntToHex(Events[i].flags, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "\n\t\tTasks Waiting:\t\t");
+        IntToStr(Events[i].waiting, info);
+        putsBufferUart0(&out, info);
+        putsBufferUart0(&out, "\n\n");
+    }
+    if(!any)
+    {
+        putsBufferUart0(&out, "No event flag groups.\n");
     }
 
+    flushBufferUart0(&out);
 }
 
 void kill(uint32_t pid)         //StopThread()
@@ -303,7 +598,7 @@ void pkill(char* proc_name)     //StopThread()
 
 void preempt(bool on)
 {
-    __asm("  SVC #9");
+    setPreemption(on);
     if(on == true)
     {
         putsUart0("Preemption is ON\n");
@@ -314,13 +609,17 @@ void preempt(bool on)
     }
 }
 
-void sched(bool prio_on)
+void sched(uint8_t mode)
 {
-    __asm("  SVC #8");
-    if(prio_on == true)
+    setSchedulerMode(mode);
+    if(mode == SCHED_PRIO)
     {
         putsUart0("Scheduler set to Priority.\n");
     }
+    else if(mode == SCHED_EDF)
+    {
+        putsUart0("Scheduler set to Earliest-Deadline-First.\n");
+    }
     else
     {
         putsUart0("Scheduler set to Round-Robin.\n");
@@ -329,7 +628,7 @@ void sched(bool prio_on)
 
 void pi(bool on)        //Priority Inheritance -- not needed
 {
-    __asm("  SVC #10");
+    setPriorityInheritance(on);
     if(on == true)
     {
         putsUart0("pi ON\n");
@@ -343,7 +642,20 @@ void pi(bool on)        //Priority Inheritance -- not needed
 
 void pidof(char* name)
 {
-    __asm("  SVC #11");
+    uint32_t pid = getPid(name);
+    char str[15];
+
+    if(pid == 0)
+    {
+        putsUart0("PID not found.\n");
+    }
+    else
+    {
+        IntToStr(pid, str);
+        putsUart0("PID: ");
+        putsUart0(str);
+        putcUart0('\n');
+    }
 }
 
 
@@ -356,187 +668,195 @@ void shell(void)
         bool valid = false;
         char proc_list[10][20] = {"Idle", "LengthyFn", "Flash4Hz", "OneShot", "ReadKeys", "Debounce", "Important", "Uncoop", "Errant", "Shell"};
 
-        if(kbhitUart0())
+        // getsUart0() sleeps until the UART0 RX interrupt delivers a line
+        getsUart0(&data);
+        parseFields(&data);
+
+        if(isCommand(&data, "reboot", 0) && (getFieldCount(&data) == 1))
         {
-            getsUart0(&data);
-            parseFields(&data);
+            valid = true;
+            reboot();
+        }
+
+        else if(isCommand(&data, "ps", 0) && (getFieldCount(&data) == 1))
+        {
+            valid = true;
+            ps();
+        }
+
+        else if(isCommand(&data, "ipcs", 0) && (getFieldCount(&data) == 1))
+        {
+            valid = true;
+            ipcs();
+        }
 
-            if(isCommand(&data, "reboot", 0) && (getFieldCount(&data) == 1))
+        else if(isCommand(&data, "kill", 1))
+        {
+            char *arg = getFieldString(&data, 1);           //Gets the input as a string
+            if(isInteger(arg) == true)                      //checks if input is an integer
             {
                 valid = true;
-                __asm("  SVC #12");
+                uint32_t pidN = getFieldInteger(&data, 1);
+                kill(pidN);
+            }
+            else
+            {
+                putsUart0("Invalid input. Enter a process number.\n");
             }
+        }
 
-            else if(isCommand(&data, "ps", 0) && (getFieldCount(&data) == 1))
+        else if(isCommand(&data, "pkill", 1))
+        {
+            char* procN = getFieldString(&data, 1);
+            if(isInteger(procN) == true)
+            {
+                valid = false;
+            }
+            else
             {
                 valid = true;
-                ps();
+                pkill(procN);
             }
+        }
 
-            else if(isCommand(&data, "ipcs", 0) && (getFieldCount(&data) == 1))
+        else if(isCommand(&data, "pi", 1))
+        {
+            bool pi_status = false;
+            char* status = getFieldString(&data, 1);
+            if((status != NULL && cmpStr(status, "ON") == 0) || (status != NULL && cmpStr(status, "on") == 0))
             {
                 valid = true;
-                ipcs();
+                pi_status = true;
             }
 
-            else if(isCommand(&data, "kill", 1))
+            else if((status != NULL && cmpStr(status, "OFF") == 0) || (status != NULL && cmpStr(status, "off") == 0))
             {
-                char *arg = getFieldString(&data, 1);           //Gets the input as a string
-                if(isInteger(arg) == true)                      //checks if input is an integer
-                {
-                    valid = true;
-                    uint32_t pidN = getFieldInteger(&data, 1);
-                    kill(pidN);
-                }
-                else
-                {
-                    putsUart0("Invalid input. Enter a process number.\n");
-                }
+                valid = true;
+                pi_status = false;
             }
 
-            else if(isCommand(&data, "pkill", 1))
+            if(valid)
             {
-                char* procN = getFieldString(&data, 1);
-                if(isInteger(procN) == true)
-                {
-                    valid = false;
-                }
-                else
-                {
-                    valid = true;
-                    pkill(procN);
-                }
+                pi(pi_status);
             }
-
-            else if(isCommand(&data, "pi", 1))
+            else
             {
-                bool pi_status = false;
-                char* status = getFieldString(&data, 1);
-                if((status != NULL && cmpStr(status, "ON") == 0) || (status != NULL && cmpStr(status, "on") == 0))
-                {
-                    valid = true;
-                    pi_status = true;
-                }
+                valid = false;
+            }
 
-                else if((status != NULL && cmpStr(status, "OFF") == 0) || (status != NULL && cmpStr(status, "off") == 0))
-                {
-                    valid = true;
-                    pi_status = false;
-                }
+        }
 
-                if(valid)
-                {
-                    pi(pi_status);
-                }
-                else
-                {
-                    valid = false;
-                }
+        else if(isCommand(&data, "preempt", 1))
+        {
 
+            bool preempt_status = false;
+            char* status = getFieldString(&data, 1);
+            if((status != NULL && cmpStr(status, "ON") == 0) || (status != NULL && cmpStr(status, "on") == 0))
+            {
+                valid = true;
+                preempt_status = true;
             }
-
-            else if(isCommand(&data, "preempt", 1))
+            else if((status != NULL && cmpStr(status, "OFF") == 0) || (status != NULL && cmpStr(status, "off") == 0))
             {
-
-                bool preempt_status = false;
-                char* status = getFieldString(&data, 1);
-                if((status != NULL && cmpStr(status, "ON") == 0) || (status != NULL && cmpStr(status, "on") == 0))
-                {
-                    valid = true;
-                    preempt_status = true;
-                }
-                else if((status != NULL && cmpStr(status, "OFF") == 0) || (status != NULL && cmpStr(status, "off") == 0))
-                {
-                    valid = true;
-                    preempt_status = false;
-                }
-
-                if(valid)
-                {
-                    preempt(preempt_status);
-                }
-                else
-                {
-                    valid = false;
-                }
+                valid = true;
+                preempt_status = false;
             }
 
-            else if(isCommand(&data, "sched", 1))
+            if(valid)
             {
-                bool sched_status = false;
-                char* schedule = getFieldString(&data, 1);
-                if((schedule != NULL && cmpStr(schedule, "PRIO") == 0) || (schedule != NULL && cmpStr(schedule, "prio") == 0))
-                {
-                    valid = true;
-                    sched_status = true;
-                }
+                preempt(preempt_status);
+            }
+            else
+            {
+                valid = false;
+            }
+        }
 
-                else if((schedule != NULL && cmpStr(schedule, "RR") == 0) || (schedule != NULL && cmpStr(schedule, "rr") == 0))
-                {
-                    valid = true;
-                    sched_status = false;
-                }
+        else if(isCommand(&data, "sched", 1))
+        {
+            uint8_t sched_status = SCHED_PRIO;
+            char* schedule = getFieldString(&data, 1);
+            if((schedule != NULL && cmpStr(schedule, "PRIO") == 0) || (schedule != NULL && cmpStr(schedule, "prio") == 0))
+            {
+                valid = true;
+                sched_status = SCHED_PRIO;
+            }
 
-                if(valid)
-                {
-                    sched(sched_status);
-                }
-                else
-                {
-                    valid = false;
-                }
+            else if((schedule != NULL && cmpStr(schedule, "RR") == 0) || (schedule != NULL && cmpStr(schedule, "rr") == 0))
+            {
+                valid = true;
+                sched_status = SCHED_RR;
             }
 
-            else if(isCommand(&data, "pidof", 1))
+            else if((schedule != NULL && cmpStr(schedule, "EDF") == 0) || (schedule != NULL && cmpStr(schedule, "edf") == 0))
             {
                 valid = true;
-                char* proc_name = getFieldString(&data, 1);
+                sched_status = SCHED_EDF;
+            }
 
-                if(isInteger(proc_name) == true)
-                {
-                    valid = false;
-                }
-                else
-                {
-                    valid = true;
-                    pidof(proc_name);
-                }
+            if(valid)
+            {
+                sched(sched_status);
+            }
+            else
+            {
+                valid = false;
             }
+        }
+
+        else if(isCommand(&data, "pidof", 1))
+        {
+            valid = true;
+            char* proc_name = getFieldString(&data, 1);
 
-            else if(isCommand(&data, "meminfo", 0))
+            if(isInteger(proc_name) == true)
+            {
+                valid = false;
+            }
+            else
             {
                 valid = true;
-                meminfo();
+                pidof(proc_name);
             }
+        }
 
-            else
+        else if(isCommand(&data, "meminfo", 0))
+        {
+            valid = true;
+            meminfo();
+        }
+
+        else if(isCommand(&data, "stack", 0) && (getFieldCount(&data) == 1))
+        {
+            valid = true;
+            stack();
+        }
+
+        else
+        {
+            if(getFieldCount(&data) == 1)
             {
-                if(getFieldCount(&data) == 1)
+                char* proc_input = getFieldString(&data, 0);
+                uint8_t i = 0;
+                for(i = 0; i < 10; i++)
                 {
-                    char* proc_input = getFieldString(&data, 0);
-                    uint8_t i = 0;
-                    for(i = 0; i < 10; i++)
+                    if(cmpStr(proc_input, proc_list[i]) == 0)  //compare the user input with the array list
                     {
-                        if(cmpStr(proc_input, proc_list[i]) == 0)  //compare the user input with the array list
-                        {
-                            valid = true;
-                            restartThread((_fn)proc_input);
-                        }
+                        valid = true;
+                        restartThread((_fn)proc_input);
                     }
                 }
-                else
-                {
-                    valid = false;
-                }
             }
-
-            if(!valid)
+            else
             {
-                putsUart0("Invalid command/process. Try again!\n");
+                valid = false;
             }
-            putsUart0("\n\nRTOS>");
         }
 
-        yield();
+        if(!valid)
+        {
+            putsUart0("Invalid command/process. Try again!\n");
+        }
+        putsUart0("\n\nRTOS>");
     }
 }
@@ -15,8 +15,13 @@ extern uint32_t* getMSP(void);
 extern void setASP(void);
 extern void setTMPL(void);
 extern void MPUFaultCause(void);
-extern uint32_t getSVCnum(void);
 extern void popREGS(void);
 extern void pushREGS(void);
+extern void applySramRegions(const uint32_t base[], const uint32_t attr[]);
 extern uint32_t ReadFromR1(void);
+extern uint32_t countLeadingZeros(uint32_t value);
+extern bool isUnprivileged(void);
+extern uint32_t raiseBasePri(uint32_t basePri);
+extern void setBasePri(uint32_t basePri);
+extern void waitForInterrupt(void);
 #endif /* SP_H_ */
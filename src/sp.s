@@ -11,15 +11,32 @@
 	.def setASP
 	.def setTMPL
 	.def MPUFaultCause
-	.def getSVCnum
 	.def popREGS
 	.def pushREGS
+	.def applySramRegions
 	.def ReadFromR1
-;-----------------------------------------------------------------------------
-; Register values and large immediate values
-;-----------------------------------------------------------------------------
-
-LINK_REG_VALUE 				.field 0xFFFFFFFD
+	.def countLeadingZeros
+	.def isUnprivileged
+	.def raiseBasePri
+	.def setBasePri
+	.def waitForInterrupt
+	.def lockTimeout
+	.def waitTimeout
+	.def queueSend
+	.def queueReceive
+	.def setEventFlags
+	.def waitEventFlags
+	.def notify
+	.def notifyTake
+	.def serialWrite
+	.def serialRead
+	.def serialWriteDma
+	.def MallocWrapper
+	.def poolGet
+	.def poolPut
+	.def getPid
+
+	.cdecls C,NOLIST,"svc.h"
 
 .thumb
 .const
@@ -64,69 +81,150 @@ MPUFaultCause:
 	MOV PC, R0
 	BX LR
 
-getSVCnum:
+popREGS:				;restoring registers LR, S16-S31, R11-R4
 	MRS R0, PSP
-	LDR R1, [R0, #24]	;Load the value at PSP + 24 bytes (PC saved during exception)
-	SUB R1, R1, #2		;Move back two bytes to point to SVC instruction
-	LDRH R2, [R1]		;Load halfword of R1 into R2
-	AND R2, R2, #0xFF   ;Mask with 0xFF to get immediate value
-	MOV R0, R2
-	ISB
+	LDR LR, [R0], #4	;EXC_RETURN saved by pushREGS (or createThread)
+	TST LR, #0x10		;bit 4 clear: the task owns an FP context
+	IT EQ
+	VLDMIAEQ R0!, {S16-S31}
+	LDMIA R0!, {R4-R11}
+	MSR PSP, R0
 	BX LR
 
-popREGS:				;restoring registers LR, R11-R4
+pushREGS:				;saving registers R4-R11, S16-S31, EXC_RETURN (in R12)
 	MRS R0, PSP
+	STMDB R0!, {R4-R11}
+	TST R12, #0x10		;S16-S31 only for tasks that have used the FPU
+	IT EQ
+	VSTMDBEQ R0!, {S16-S31}	;also flushes a pending lazy save of S0-S15
+	STR R12, [R0, #-4]!
+	MSR PSP, R0
+	BX LR
 
-	LDR LR, LINK_REG_VALUE
-	ADD R0, #4
-	LDR R11, [R0]
-	ADD R0, #4
-	LDR R10, [R0]
-	ADD R0, #4
-	LDR R9, [R0]
-	ADD R0, #4
-	LDR R8, [R0]
-	ADD R0, #4
-	LDR R7, [R0]
-	ADD R0, #4
-	LDR R6, [R0]
-	ADD R0, #4
-	LDR R5, [R0]
-	ADD R0, #4
-	LDR R4, [R0]
-	ADD R0, #4
+applySramRegions:		;writes regions 2-6, RBAR values in R0[0..4] and RASR values in R1[0..4]
+	PUSH {R4-R9}
+	MOVW R12, #0xED9C	;NVIC_MPU_BASE_R, followed by the ATTR and 3 alias pairs
+	MOVT R12, #0xE000
+	LDMIA R0!, {R2, R4, R6, R8}	;regions 2-5, paired up as RBAR/RASR
+	LDMIA R1!, {R3, R5, R7, R9}
+	STMIA R12, {R2-R9}
+	LDR R2, [R0]		;region 6
+	LDR R3, [R1]
+	STMIA R12, {R2-R3}
+	POP {R4-R9}
+	BX LR
 
-	MSR PSP, R0
-	ISB
+ReadFromR1:
+	MOV R1, R0
 	BX LR
 
-pushREGS:				;saving registers R4-R11
-	MRS R0, PSP
+countLeadingZeros:
+	CLZ R0, R0			;Number of zero bits above the highest set bit (32 if R0 is 0)
+	BX LR
 
-	SUB R0, R0, #4
-	STR R4, [R0]
-	SUB R0, R0, #4
-	STR R5, [R0]
-	SUB R0, R0, #4
-	STR R6, [R0]
-	SUB R0, R0, #4
-	STR R7, [R0]
-	SUB R0, R0, #4
-	STR R8, [R0]
-	SUB R0, R0, #4
-	STR R9, [R0]
-	SUB R0, R0, #4
-	STR R10, [R0]
-	SUB R0, R0, #4
-	STR R11, [R0]
-	SUB R0, R0, #4
+isUnprivileged:			;1 in unprivileged thread mode (a task), 0 in handlers or privileged code
+	MRS R1, IPSR		;exception number, 0 in thread mode
+	MRS R0, CONTROL
+	AND R0, R0, #1		;TMPL bit
+	CMP R1, #0
+	IT NE
+	MOVNE R0, #0		;handlers are always privileged
+	BX LR
 
-	MSR PSP, R0
+raiseBasePri:			;raises BASEPRI to R0 (never lowers it) and returns the old value
+	MRS R1, BASEPRI
+	MSR BASEPRI_MAX, R0
 	ISB
+	MOV R0, R1
 	BX LR
 
-ReadFromR1:
-	MOV R1, R0
+setBasePri:
+	MSR BASEPRI, R0
+	ISB
+	BX LR
+
+waitForInterrupt:		;sleeps until an interrupt is pending (allowed unprivileged)
+	DSB
+	WFI
+	BX LR
+
+;Service call wrappers that return a value. The call number goes in R12 and
+;the arguments stay in R0-R3; svCallIsr leaves the handler's result in the
+;stacked R0, which is what R0 holds here when the SVC returns.
+
+lockTimeout:			;true if the mutex was taken within timeout ms (0 only tries)
+	MOV R12, #SVC_LOCK_TIMEOUT
+	SVC #0
+	BX LR
+
+waitTimeout:			;true if the semaphore count was taken within timeout ms
+	MOV R12, #SVC_WAIT_TIMEOUT
+	SVC #0
+	BX LR
+
+queueSend:				;true if the message was queued within timeout ms
+	MOV R12, #SVC_QUEUE_SEND
+	SVC #0
+	BX LR
+
+queueReceive:			;true if a message was received within timeout ms
+	MOV R12, #SVC_QUEUE_RECEIVE
+	SVC #0
+	BX LR
+
+setEventFlags:			;flags still set once the woken tasks cleared theirs
+	MOV R12, #SVC_SET_EVENTS
+	SVC #0
+	BX LR
+
+waitEventFlags:			;flags of the mask that ended the wait, 0 on a timeout
+	MOV R12, #SVC_WAIT_EVENTS
+	SVC #0
+	BX LR
+
+notify:					;false if there is no running thread fn
+	MOV R12, #SVC_NOTIFY
+	SVC #0
+	BX LR
+
+notifyTake:				;notification word taken, 0 on a timeout
+	MOV R12, #SVC_NOTIFY_TAKE
+	SVC #0
+	BX LR
+
+serialWrite:			;characters queued for UART0, without blocking
+	MOV R12, #SVC_SERIAL_WRITE
+	SVC #0
+	BX LR
+
+serialRead:				;characters taken (waiting, with len 0), without blocking
+	MOV R12, #SVC_SERIAL_READ
+	SVC #0
+	BX LR
+
+serialWriteDma:			;UART0_DMA_STARTED, UART0_DMA_BUSY or UART0_DMA_INVALID
+	MOV R12, #SVC_SERIAL_DMA
+	SVC #0
+	BX LR
+
+MallocWrapper:			;heap buffer the caller gets access to, 0 if none is free
+	MOV R12, #SVC_MALLOC
+	SVC #0
+	BX LR
+
+poolGet:				;block from the pool, 0 if it is empty
+	MOV R12, #SVC_POOL_GET
+	SVC #0
+	BX LR
+
+poolPut:				;false if the block is not one the caller holds or is already free
+	MOV R12, #SVC_POOL_PUT
+	SVC #0
+	BX LR
+
+getPid:					;pid of the named thread, 0 if there is none
+	MOV R12, #SVC_PIDOF
+	SVC #0
 	BX LR
 
 
@@ -0,0 +1,59 @@
+// Service call numbers
+// Shared by kernel.c and the wrappers in sp.s
+
+//-----------------------------------------------------------------------------
+// Hardware Target
+//-----------------------------------------------------------------------------
+
+// Target uC:       TM4C123GH6PM
+// System Clock:    40 MHz
+
+#ifndef SVC_H_
+#define SVC_H_
+
+// A wrapper leaves the call number in R12 and issues SVC #0. The exception
+// stacks R0-R3 and R12, so svCallIsr reads the number from the frame, calls
+// the handler with the four argument registers and stores the result in the
+// stacked R0, which the wrapper returns.
+#define SVC_LAUNCH              0
+#define SVC_YIELD               1
+#define SVC_SLEEP               2
+#define SVC_LOCK                3
+#define SVC_UNLOCK              4
+#define SVC_WAIT                5
+#define SVC_POST                6
+#define SVC_MALLOC              7
+#define SVC_SCHED               8
+#define SVC_PREEMPT             9
+#define SVC_PI                  10
+#define SVC_PIDOF               11
+#define SVC_REBOOT              12
+#define SVC_STOP_THREAD         13
+#define SVC_RESTART_THREAD      14
+#define SVC_SET_PRIORITY        15
+#define SVC_MUTEX_SEMA_INFO     16
+#define SVC_WAIT_NEXT_PERIOD    17
+#define SVC_TCB_INFO            18
+#define SVC_CPU_INFO            19
+#define SVC_LOCK_TIMEOUT        20
+#define SVC_WAIT_TIMEOUT        21
+#define SVC_QUEUE_SEND          22
+#define SVC_QUEUE_RECEIVE       23
+#define SVC_FREE                24
+#define SVC_QUEUE_INFO          25
+#define SVC_SET_EVENTS          26
+#define SVC_CLEAR_EVENTS        27
+#define SVC_WAIT_EVENTS         28
+#define SVC_EVENT_INFO          29
+#define SVC_NOTIFY              30
+#define SVC_NOTIFY_TAKE         31
+#define SVC_SERIAL_WRITE        32
+#define SVC_SERIAL_READ         33
+#define SVC_SERIAL_DMA          34
+#define SVC_POOL_GET            35
+#define SVC_POOL_PUT            36
+#define SVC_HEAP_INFO           37
+#define SVC_STACK_SCAN          38
+#define NUM_SYSCALLS            39
+
+#endif
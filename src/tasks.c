@@ -18,10 +18,12 @@
 #include "clock.h"
 #include "uart0.h"
 #include "gpio.h"
+#include "nvic.h"
 #include "wait.h"
 #include "kernel.h"
 #include "tasks.h"
 #include "mm.h"
+#include "sp.h"
 
 //#define BLUE_LED   PORTF,2 // on-board blue LED
 //#define RED_LED    PORTE,0 // off-board red LED
@@ -139,11 +141,10 @@ void idle(void)
 {
     while(true)
     {
-        //lock(resource);
+        scanStacks();
         setPinValue(ORANGE_LED, 1);
-        waitMicrosecond(1000);
+        waitForInterrupt();             //sleep until SysTick or a device interrupt
         setPinValue(ORANGE_LED, 0);
-        //unlock(resource);
         yield();
     }
 }
@@ -153,7 +154,7 @@ void flash4Hz(void)
     while(true)
     {
         setPinValue(GREEN_LED, !getPinValue(GREEN_LED));
-        sleep(125);
+        waitNextPeriod();
     }
 }
 
@@ -297,12 +298,14 @@ void LedTimer(void)
      TIMER1_TAILR_R = 40000000;                          // Timer Ticks # = Seconds x Clock Freq.
      TIMER1_IMR_R = TIMER_IMR_TATOIM;                     // turn-on interrupts for timeout in timer module
      TIMER1_CTL_R |= TIMER_CTL_TAEN;                      // turn-on timer
+     setNvicInterruptPriority(INT_TIMER1A, MAX_SYSCALL_PRIORITY); // may call the FromIsr functions
      NVIC_EN0_R = 1 << (INT_TIMER1A-16);                  // turn-on interrupt 37 (TIMER1A)
      setPinValue(BOARD_GREEN_LED, 1);
 }
 
 void TimerIsr(void)
 {
+    TIMER1_ICR_R = TIMER_ICR_TATOCINT;                    // clear interrupt flag
     setPinValue(BOARD_GREEN_LED, 0);
 
 }
@@ -35,7 +35,7 @@ SECTIONS
     .pinit  :   > FLASH
     .init_array : > FLASH
 
-    .vtable :   > 0x20000000
+    .dmaTable : > 0x20000000
     .data   :   > SRAM
     .bss    :   > SRAM
     .sysmem :   > SRAM
@@ -13,6 +13,17 @@
 // UART Interface:
 //   U0TX (PA1) and U0RX (PA0) are connected to the 2nd controller
 //   The USB on the 2nd controller enumerates to an ICDI interface and a virtual COM port
+//   RX and TX interrupts move data between the FIFOs and two ring buffers
+//
+// The rings live in kernel memory. Tasks reach them through the serialRead()
+// and serialWrite() service calls and block on the uart0Events flags while
+// the RX ring is empty or the TX ring is full. Privileged callers (main()
+// before the RTOS starts, service calls and fault handlers) cannot block, so
+// they move the data themselves until the ring has room or a character.
+//
+// Long output can bypass the TX ring: sendUart0Dma() hands a whole buffer to
+// uDMA channel 9 (UART0 TX), which feeds the TX FIFO on its own and raises
+// the UART0 interrupt once the last character is queued.
 
 //-----------------------------------------------------------------------------
 // Device includes, defines, and assembler directives
@@ -22,15 +33,52 @@
 #include <stdbool.h>
 #include "tm4c123gh6pm.h"
 #include "uart0.h"
+#include "kernel.h"
+#include "nvic.h"
+#include "sp.h"
 
 // PortA masks
 #define UART_TX_MASK 2
 #define UART_RX_MASK 1
 
+// Ring buffers (sizes are powers of 2)
+#define TX_RING_SIZE 128
+#define RX_RING_SIZE 32
+#define UART0_NVIC_BIT (1 << (INT_UART0 - 16))
+
+// uDMA
+#define DMA_UART0_TX 9                      // channel 9, encoding 0
+#define DMA_CHANNEL (1 << DMA_UART0_TX)
+
 //-----------------------------------------------------------------------------
 // Global variables
 //-----------------------------------------------------------------------------
 
+// Each ring has one producer and one consumer, which each own one index
+char txRing[TX_RING_SIZE];
+volatile uint32_t txHead = 0;       // written by writeUart0()
+volatile uint32_t txTail = 0;       // written by serviceUart0()
+char rxRing[RX_RING_SIZE];
+volatile uint32_t rxHead = 0;       // written by serviceUart0()
+volatile uint32_t rxTail = 0;       // written by readUart0()
+
+// uDMA channel control table. Only the primary entries up to channel 9 are
+// used, but the controller requires the table on a 1 KiB boundary.
+typedef struct _DMA_CONTROL
+{
+    volatile const void *srcEnd;
+    volatile void *dstEnd;
+    uint32_t control;
+    uint32_t unused;
+} DMA_CONTROL;
+
+// The linker command file puts the table at the start of SRAM, so the
+// 1024-byte alignment leaves no gap in the kernel's 4 KiB
+#pragma DATA_SECTION(dmaTable, ".dmaTable")
+#pragma DATA_ALIGN(dmaTable, 1024)
+DMA_CONTROL dmaTable[DMA_UART0_TX + 1];
+volatile bool dmaBusy = false;      // channel 9 owns the TX FIFO
+
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
@@ -59,6 +107,25 @@ void initUart0()
     UART0_LCRH_R = UART_LCRH_WLEN_8 | UART_LCRH_FEN;    // configure for 8N1 w/ 16-level FIFO
     UART0_CTL_R = UART_CTL_TXE | UART_CTL_RXE | UART_CTL_UARTEN;
                                                         // enable TX, RX, and module
+
+    // Interrupt when the TX FIFO drains to 2 characters, when the RX FIFO
+    // is half full and when a character has sat in the RX FIFO for 32 bits
+    UART0_IFLS_R = UART_IFLS_TX1_8 | UART_IFLS_RX4_8;
+    UART0_IM_R = UART_IM_TXIM | UART_IM_RXIM | UART_IM_RTIM;
+    setNvicInterruptPriority(INT_UART0, MAX_SYSCALL_PRIORITY);  // calls setEventFlagsFromIsr()
+    NVIC_EN0_R = UART0_NVIC_BIT;                        // turn-on interrupt 21 (UART0)
+
+    // Configure uDMA channel 9 for UART0 TX (basic mode, single and burst requests)
+    SYSCTL_RCGCDMA_R |= SYSCTL_RCGCDMA_R0;
+    _delay_cycles(3);
+    UDMA_CFG_R = UDMA_CFG_MASTEN;
+    UDMA_CTLBASE_R = (uint32_t)dmaTable;
+    UDMA_CHMAP1_R &= ~UDMA_CHMAP1_CH9SEL_M;
+    UDMA_PRIOCLR_R = DMA_CHANNEL;
+    UDMA_ALTCLR_R = DMA_CHANNEL;
+    UDMA_USEBURSTCLR_R = DMA_CHANNEL;
+    UDMA_REQMASKCLR_R = DMA_CHANNEL;
+    dmaTable[DMA_UART0_TX].dstEnd = &UART0_DR_R;
 }
 
 // Set baud rate as function of instruction cycle frequency
@@ -75,30 +142,249 @@ void setUart0BaudRate(uint32_t baudRate, uint32_t fcyc)
                                                         // turn-on UART0
 }
 
-// Blocking function that writes a serial character when the UART buffer is not full
+// Moves received characters into the RX ring and queued characters into
+// the TX FIFO, then wakes the tasks waiting on either ring
+void serviceUart0(void)
+{
+    uint32_t events = 0;
+    char c;
+
+    if (dmaBusy && !(UDMA_ENASET_R & DMA_CHANNEL))   // the channel disables itself when done
+    {
+        UDMA_CHIS_R = DMA_CHANNEL;
+        UART0_DMACTL_R &= ~UART_DMACTL_TXDMAE;
+        dmaBusy = false;
+        events |= UART0_TX_DONE;
+    }
+    while (!(UART0_FR_R & UART_FR_RXFE))
+    {
+        c = UART0_DR_R & 0xFF;
+        if (rxHead - rxTail < RX_RING_SIZE)             // drop characters while the ring is full
+        {
+            rxRing[rxHead % RX_RING_SIZE] = c;
+            rxHead++;
+        }
+        events |= UART0_RX_READY;
+    }
+    while (!dmaBusy && txTail != txHead && !(UART0_FR_R & UART_FR_TXFF))
+    {
+        UART0_DR_R = txRing[txTail % TX_RING_SIZE];
+        txTail++;
+        events |= UART0_TX_SPACE;
+    }
+    if (events != 0)
+    {
+        setEventFlagsFromIsr(uart0Events, events);
+    }
+}
+
+// Services the FIFOs from outside the interrupt, which is masked meanwhile
+// so the two never move the same index
+void pollUart0(void)
+{
+    NVIC_DIS0_R = UART0_NVIC_BIT;
+    serviceUart0();
+    NVIC_EN0_R = UART0_NVIC_BIT;
+}
+
+void uart0Isr(void)
+{
+    UART0_ICR_R = UART_ICR_TXIC | UART_ICR_RXIC | UART_ICR_RTIC;
+    serviceUart0();
+}
+
+// Queues up to len characters for transmission (privileged callers only).
+// Returns the number queued, 0 if the TX ring is full.
+uint32_t writeUart0(const char str[], uint32_t len)
+{
+    uint32_t n = 0;
+    while (n < len && txHead - txTail < TX_RING_SIZE)
+    {
+        txRing[txHead % TX_RING_SIZE] = str[n++];
+        txHead++;
+    }
+    pollUart0();                                        // start sending if the transmitter is idle
+    return n;
+}
+
+// Takes up to len received characters (privileged callers only).
+// Returns the number taken, 0 if the RX ring is empty.
+uint32_t readUart0(char str[], uint32_t len)
+{
+    uint32_t n = 0;
+    while (n < len && rxTail != rxHead)
+    {
+        str[n++] = rxRing[rxTail % RX_RING_SIZE];
+        rxTail++;
+    }
+    return n;
+}
+
+// Number of received characters waiting in the RX ring
+uint32_t availableUart0(void)
+{
+    return rxHead - rxTail;
+}
+
+// Waits until every queued character has been handed to the UART, for
+// fault handlers that never return
+void flushUart0(void)
+{
+    while (dmaBusy || txTail != txHead)
+    {
+        pollUart0();
+    }
+}
+
+// Starts a uDMA transfer of 1 to DMA_MAX_TRANSFER characters (privileged
+// callers only). Returns false while the TX ring still holds characters or
+// another transfer is running, so output keeps its order.
+bool startUart0Dma(const char str[], uint32_t len)
+{
+    bool ok;
+    NVIC_DIS0_R = UART0_NVIC_BIT;
+    ok = !dmaBusy && txTail == txHead;
+    if (ok)
+    {
+        dmaBusy = true;
+        dmaTable[DMA_UART0_TX].srcEnd = &str[len - 1];
+        dmaTable[DMA_UART0_TX].control = UDMA_CHCTL_DSTINC_NONE | UDMA_CHCTL_DSTSIZE_8
+                                       | UDMA_CHCTL_SRCINC_8 | UDMA_CHCTL_SRCSIZE_8
+                                       | UDMA_CHCTL_ARBSIZE_4
+                                       | ((len - 1) << UDMA_CHCTL_XFERSIZE_S)
+                                       | UDMA_CHCTL_XFERMODE_BASIC;
+        UDMA_ENASET_R = DMA_CHANNEL;
+        UART0_DMACTL_R |= UART_DMACTL_TXDMAE;
+    }
+    NVIC_EN0_R = UART0_NVIC_BIT;
+    return ok;
+}
+
+// Sends len characters by uDMA and returns once the last one is in the TX
+// FIFO. A task sleeps on uart0Events meanwhile; str must be flash or memory
+// the task owns, and must not change until the call returns.
+void sendUart0Dma(const char str[], uint32_t len)
+{
+    uint32_t n;
+    uint8_t status;
+    while (len > 0)
+    {
+        n = (len > DMA_MAX_TRANSFER) ? DMA_MAX_TRANSFER : len;
+        if (isUnprivileged())
+        {
+            while ((status = serialWriteDma(str, n)) == UART0_DMA_BUSY)
+            {
+                waitEventFlags(uart0Events, UART0_TX_SPACE | UART0_TX_DONE, EVENT_WAIT_ANY | EVENT_CLEAR, WAIT_FOREVER);
+            }
+            if (status == UART0_DMA_INVALID)
+            {
+                return;
+            }
+            waitEventFlags(uart0Events, UART0_TX_DONE, EVENT_WAIT_ANY | EVENT_CLEAR, WAIT_FOREVER);
+        }
+        else
+        {
+            while (!startUart0Dma(str, n))
+            {
+                pollUart0();
+            }
+            while (dmaBusy)
+            {
+                pollUart0();
+            }
+        }
+        str += n;
+        len -= n;
+    }
+}
+
+// Buffered output: the caller's buffer is sent in one uDMA transfer each
+// time it fills, and by flushBufferUart0() at the end
+void putcBufferUart0(UART_BUFFER *buffer, char c)
+{
+    if (buffer->count == UART_BUFFER_SIZE)
+    {
+        flushBufferUart0(buffer);
+    }
+    buffer->data[buffer->count++] = c;
+}
+
+void putsBufferUart0(UART_BUFFER *buffer, const char str[])
+{
+    while (*str != '\0')
+    {
+        putcBufferUart0(buffer, *str++);
+    }
+}
+
+void flushBufferUart0(UART_BUFFER *buffer)
+{
+    sendUart0Dma(buffer->data, buffer->count);
+    buffer->count = 0;
+}
+
+// Writes len characters, blocking a task while the TX ring is full
+void sendUart0(const char str[], uint32_t len)
+{
+    uint32_t n;
+    while (len > 0)
+    {
+        if (isUnprivileged())
+        {
+            n = serialWrite(str, len);
+            if (n == 0)
+            {
+                waitEventFlags(uart0Events, UART0_TX_SPACE, EVENT_WAIT_ANY | EVENT_CLEAR, WAIT_FOREVER);
+            }
+        }
+        else
+        {
+            n = writeUart0(str, len);
+        }
+        str += n;
+        len -= n;
+    }
+}
+
+// Blocking function that writes a serial character when the TX ring is not full
 void putcUart0(char c)
 {
-    while (UART0_FR_R & UART_FR_TXFF);               // wait if uart0 tx fifo full
-    UART0_DR_R = c;                                  // write character to fifo
+    sendUart0(&c, 1);
 }
 
-// Blocking function that writes a string when the UART buffer is not full
+// Blocking function that writes a string when the TX ring is not full
 void putsUart0(char* str)
 {
-    uint8_t i = 0;
-    while (str[i] != '\0')
-        putcUart0(str[i++]);
+    uint32_t len = 0;
+    while (str[len] != '\0')
+        len++;
+    sendUart0(str, len);
 }
 
-// Blocking function that returns with serial data once the buffer is not empty
+// Blocking function that returns with serial data once the RX ring is not
+// empty. A task sleeps on uart0Events until the RX interrupt wakes it.
 char getcUart0()
 {
-    while (UART0_FR_R & UART_FR_RXFE);               // wait if uart0 rx fifo empty
-    return UART0_DR_R & 0xFF;                        // get character from fifo
+    char c;
+    if (isUnprivileged())
+    {
+        while (serialRead(&c, 1) == 0)
+        {
+            waitEventFlags(uart0Events, UART0_RX_READY, EVENT_WAIT_ANY | EVENT_CLEAR, WAIT_FOREVER);
+        }
+    }
+    else
+    {
+        while (readUart0(&c, 1) == 0)
+        {
+            pollUart0();
+        }
+    }
+    return c;
 }
 
 // Returns the status of the receive buffer
 bool kbhitUart0()
 {
-    return !(UART0_FR_R & UART_FR_RXFE);
+    return (isUnprivileged() ? serialRead(0, 0) : availableUart0()) != 0;
 }
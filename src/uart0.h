@@ -21,6 +21,27 @@
 #ifndef UART0_H_
 #define UART0_H_
 
+// uart0Events flags
+#define UART0_RX_READY 0x00000001   // characters arrived in the RX ring
+#define UART0_TX_SPACE 0x00000002   // characters left the TX ring
+#define UART0_TX_DONE  0x00000004   // a uDMA transfer finished
+
+#define DMA_MAX_TRANSFER 1024      // characters per uDMA transfer
+
+// serialWriteDma() results
+#define UART0_DMA_BUSY    0         // TX ring or an earlier transfer still sending
+#define UART0_DMA_STARTED 1
+#define UART0_DMA_INVALID 2         // buffer is not readable by the task
+
+// Output buffer for sendUart0Dma(), kept on the caller's stack
+#define UART_BUFFER_SIZE 256
+
+typedef struct _UART_BUFFER
+{
+    char data[UART_BUFFER_SIZE];
+    uint16_t count;
+} UART_BUFFER;
+
 //-----------------------------------------------------------------------------
 // Subroutines
 //-----------------------------------------------------------------------------
@@ -31,5 +52,16 @@ void putcUart0(char c);
 void putsUart0(char* str);
 char getcUart0();
 bool kbhitUart0();
+void flushUart0(void);
+void sendUart0Dma(const char str[], uint32_t len);
+void putcBufferUart0(UART_BUFFER *buffer, char c);
+void putsBufferUart0(UART_BUFFER *buffer, const char str[]);
+void flushBufferUart0(UART_BUFFER *buffer);
+
+void uart0Isr(void);
+uint32_t writeUart0(const char str[], uint32_t len);
+uint32_t readUart0(char str[], uint32_t len);
+uint32_t availableUart0(void);
+bool startUart0Dma(const char str[], uint32_t len);
 
 #endif
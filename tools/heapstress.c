@@ -0,0 +1,307 @@
+// Heap stress benchmark (host)
+//
+// Runs randomized mallocFromHeap()/freeToHeap() sequences from src/mm.c on
+// the build machine. A shadow list of the live allocations is used to check
+// every result:
+//   - blocks handed out lie inside the heap and never overlap a live one
+//   - no two live allocations share an MPU subregion
+//   - allocationSize() returns the size that was requested
+//   - freeing a pointer twice, or one that is not the start of an allocation,
+//     changes nothing
+//   - getHeapStats() agrees with the live list
+//   - the heap is empty again, with every buddy merged, once everything is freed
+//   - block pools hand out each block once, reject a second put and a put by
+//     anyone but the holder, give back all of an owner's blocks at once, and
+//     report a subregion as held while any block in it is out
+// and the average cost of each call is printed.
+//
+// The allocator only computes heap addresses and never dereferences them, so
+// it runs unchanged on the host.
+//
+// Build and run from the repository root:
+//   gcc -O2 -Isrc -o heapstress tools/heapstress.c
+//   ./heapstress [seed] [operations]
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/mm.c"
+
+#define MAX_LIVE 64
+
+typedef struct _liveAllocation
+{
+    uintptr_t base;
+    uint32_t footprint;         // bytes of heap blocks taken
+    uint32_t size;              // bytes requested
+    uint64_t window;            // SRD bits of the subregions it spans
+} liveAllocation;
+
+liveAllocation live[MAX_LIVE];
+uint32_t liveCount = 0;
+uint32_t errors = 0;
+
+// Stubs for the target-only functions mm.c refers to
+void putsUart0(char* str)
+{
+    fputs(str, stdout);
+}
+
+void applySramRegions(const uint32_t base[], const uint32_t attr[])
+{
+}
+
+uint32_t countLeadingZeros(uint32_t value)
+{
+    return (value == 0) ? 32 : __builtin_clz(value);
+}
+
+uint64_t nanoseconds(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+void fail(const char *what, uintptr_t address, uint32_t size)
+{
+    if (errors++ < 10)
+    {
+        printf("FAIL: %s (address 0x%08lX, size %u)\n", what, (unsigned long)address, size);
+    }
+}
+
+// Heap bytes an allocation takes: whole subregions, which are 512B below
+// 0x20004000 and 1024B above
+uint32_t footprint(uintptr_t address, uint32_t size)
+{
+    uint32_t subregion = (address < 0x20004000) ? 512 : 1024;
+    if (size == 0)
+    {
+        size = 1;
+    }
+    return (size + subregion - 1) / subregion * subregion;
+}
+
+// Sizes around the block boundaries, with mostly small requests
+uint32_t randomSize(void)
+{
+    static const uint32_t sizes[] = {1, 32, 100, 511, 512, 513, 1000, 1024, 1025, 1536, 2048, 3000, 4096, 6000, 8192};
+    if (rand() % 4 != 0)
+    {
+        return 1 + rand() % 512;
+    }
+    return sizes[rand() % (sizeof(sizes) / sizeof(sizes[0]))];
+}
+
+void checkAllocation(uintptr_t address, uint32_t size)
+{
+    uint32_t bytes = footprint(address, size);
+    uint64_t window = sramWindowMask((uint32_t*)address, bytes);
+    uint32_t i;
+    if (address < HeapBase || address + bytes > HeapLimit || address % 512 != 0)
+    {
+        fail("block outside the heap", address, size);
+    }
+    for (i = 0; i < liveCount; i++)
+    {
+        if (address < live[i].base + live[i].footprint && live[i].base < address + bytes)
+        {
+            fail("block overlaps a live allocation", address, size);
+        }
+        if ((window & live[i].window) != 0)
+        {
+            fail("block shares a subregion with a live allocation", address, size);
+        }
+    }
+    if (allocationSize((void*)address) != size)
+    {
+        fail("allocationSize() does not match the request", address, size);
+    }
+}
+
+void checkStats(void)
+{
+    heapStats stats;
+    uint32_t inUse = 0, requested = 0;
+    uint32_t i;
+    getHeapStats(&stats);
+    for (i = 0; i < liveCount; i++)
+    {
+        inUse += live[i].footprint;
+        requested += live[i].size;
+    }
+    if (stats.bytesInUse != inUse || stats.bytesRequested != requested || stats.allocations != liveCount
+        || stats.peakInUse < inUse || stats.largestFreeBlock > stats.largestFreeRun
+        || stats.largestFreeRun > stats.heapBytes - inUse)
+    {
+        fail("heap statistics do not match the live allocations", 0, inUse);
+    }
+}
+
+// Random gets and puts on one block pool by three owners, checked against
+// a shadow map of the blocks that are out and who holds them
+void checkPool(uint16_t blockSize, uint16_t blocks, uint32_t operations)
+{
+    blockPool pool, tooBig;
+    bool out[MAX_POOL_BLOCKS] = {false};
+    uint8_t owner[MAX_POOL_BLOCKS];
+    uint32_t op, n, i, held = 0;
+    uint8_t *block;
+    uint8_t who;
+    bool shared;
+
+    if (!createBlockPool(&pool, blockSize, blocks) || createBlockPool(&tooBig, blockSize, MAX_POOL_BLOCKS + 1))
+    {
+        fail("pool not created as requested", 0, blockSize);
+        return;
+    }
+    blockSize = pool.blockSize;
+    for (op = 0; op < operations; op++)
+    {
+        if (held > 0 && rand() % 64 == 0)
+        {
+            who = rand() % 3;                       //owner killed
+            putOwnedBlocks(&pool, who);
+            for (n = 0; n < blocks; n++)
+            {
+                if (out[n] && owner[n] == who)
+                {
+                    out[n] = false;
+                    held--;
+                }
+            }
+        }
+        else if (held < blocks && rand() % 2 == 0)
+        {
+            who = rand() % 3;
+            block = getBlock(&pool, who);
+            n = (block - pool.base) / blockSize;
+            if (block == 0 || (block - pool.base) % blockSize != 0 || n >= blocks || out[n])
+            {
+                fail("pool handed out a bad block", (uintptr_t)block, blockSize);
+                continue;
+            }
+            out[n] = true;
+            owner[n] = who;
+            held++;
+        }
+        else if (held > 0)
+        {
+            do
+            {
+                n = rand() % blocks;
+            } while (!out[n]);
+            block = pool.base + n * blockSize;
+            shared = false;
+            for (i = 0; i < blocks; i++)
+            {
+                if (i != n && out[i] && (sramWindowMask((uint32_t*)(pool.base + i * blockSize), blockSize)
+                                         & sramWindowMask((uint32_t*)block, blockSize)) != 0)
+                {
+                    shared = true;
+                }
+            }
+            if (putBlock(&pool, block, (owner[n] + 1) % 3))
+            {
+                fail("pool put accepted from a task not holding the block", (uintptr_t)block, blockSize);
+            }
+            if (!putBlock(&pool, block, owner[n]) || putBlock(&pool, block, owner[n]) || putBlock(&pool, block + 4, owner[n]))
+            {
+                fail("pool put not accepted exactly once", (uintptr_t)block, blockSize);
+            }
+            if (blockWindowHeld(&pool, block) != shared)
+            {
+                fail("pool subregion use is wrong", (uintptr_t)block, blockSize);
+            }
+            out[n] = false;
+            held--;
+        }
+        if (pool.freeCount != blocks - held)
+        {
+            fail("pool free count is wrong", 0, pool.freeCount);
+        }
+    }
+    freeToHeap(pool.base);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t seed = (argc > 1) ? strtoul(argv[1], 0, 0) : 1;
+    uint32_t operations = (argc > 2) ? strtoul(argv[2], 0, 0) : 1000000;
+    uint64_t mallocTime = 0, freeTime = 0, t0;
+    uint32_t mallocs = 0, frees = 0, full = 0;
+    uint32_t op, i, size;
+    uint64_t before;
+    void *p;
+
+    srand(seed);
+    for (op = 0; op < operations; op++)
+    {
+        if (liveCount < MAX_LIVE && (liveCount == 0 || rand() % 2 == 0))
+        {
+            size = randomSize();
+            t0 = nanoseconds();
+            p = mallocFromHeap(size);
+            mallocTime += nanoseconds() - t0;
+            mallocs++;
+            if (p == 0)
+            {
+                full++;
+                continue;
+            }
+            checkAllocation((uintptr_t)p, size);
+            live[liveCount].base = (uintptr_t)p;
+            live[liveCount].footprint = footprint((uintptr_t)p, size);
+            live[liveCount].size = size;
+            live[liveCount].window = sramWindowMask(p, live[liveCount].footprint);
+            liveCount++;
+        }
+        else
+        {
+            i = rand() % liveCount;
+            p = (void*)live[i].base;
+            t0 = nanoseconds();
+            freeToHeap(p);
+            freeTime += nanoseconds() - t0;
+            frees++;
+            live[i] = live[--liveCount];
+
+            // a second free, and a pointer into the middle of a block, are ignored
+            before = MemUse;
+            freeToHeap(p);
+            freeToHeap((uint8_t*)p + 4);
+            if (MemUse != before)
+            {
+                fail("invalid free changed the heap", (uintptr_t)p, 0);
+            }
+            if (allocationSize(p) != 0)
+            {
+                fail("freed block still has a size", (uintptr_t)p, 0);
+            }
+        }
+        checkStats();
+    }
+
+    while (liveCount > 0)
+    {
+        freeToHeap((void*)live[--liveCount].base);
+    }
+    if (MemUse != 0 || FreeBlocks[3] != 1ULL << 8 || FreeBlocks[4] != 1ULL << 16 || FreeBlocks[5] != 1ULL << 32)
+    {
+        fail("heap not empty after freeing everything", 0, 0);
+    }
+    checkPool(32, 16, operations / 10);
+    checkPool(100, MAX_POOL_BLOCKS, operations / 10);
+    checkPool(600, 7, operations / 10);
+
+    printf("seed %u, %u operations: %u mallocs (%u heap full), %u frees\n",
+           seed, operations, mallocs, full, frees);
+    printf("mallocFromHeap: %.1f ns/call\n", mallocs ? (double)mallocTime / mallocs : 0.0);
+    printf("freeToHeap:     %.1f ns/call\n", frees ? (double)freeTime / frees : 0.0);
+    printf("%s (%u errors)\n", errors ? "FAIL" : "PASS", errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,232 @@
+// Kernel host harness
+//
+// Lets a tool on the build machine include src/mm.c and src/kernel.c and
+// run the real scheduler, wakeup list, tickless idle and service call
+// handlers. The memory the kernel touches is mapped at its target address:
+//   - SRAM at 0x20000000, so thread stacks come from the real heap
+//   - the system control space page at 0xE000E000 (SysTick, NVIC, MPU)
+//   - the DWT page at 0xE0001000 (cycle counter)
+// The Cortex-M instructions in kernel.c compile away, and the sp.s, uart0.c
+// and getInput.c routines the kernel calls are replaced below.
+//
+// The harness plays the processor. It keeps the cycle count, counts SysTick
+// down, calls systickIsr() when the count reaches zero and pendSvIsr()
+// whenever kernel code pends PendSV. taskCurrent is the thread the tool
+// runs next. A thread's service call is made by calling its svc handler
+// and then hostPendSv(), which is what the return from SVCall does.
+//
+// The kernel keeps code and data addresses in 32-bit words, so tools using
+// this header are built with -no-pie. MAX_TASKS may be set on the command
+// line; task indices are uint8_t with 0xFF as NO_TASK, so it stays <= 255.
+
+#ifndef HOSTKERNEL_H_
+#define HOSTKERNEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define __asm(...)                  // no Cortex-M instructions on the host
+#define naked unused                // pendSvIsr() is called as a plain function
+
+// Addresses the kernel keeps in 32-bit words all lie below 4 GiB here
+#pragma GCC diagnostic ignored "-Wpointer-to-int-cast"
+#pragma GCC diagnostic ignored "-Wint-to-pointer-cast"
+
+#include "../src/mm.c"
+#include "../src/kernel.c"
+
+//-----------------------------------------------------------------------------
+// sp.s, uart0.c and getInput.c
+//-----------------------------------------------------------------------------
+
+uint32_t *hostPsp;
+
+void setPSP(uint32_t* p)
+{
+    hostPsp = p;
+}
+
+uint32_t* getPSP(void)
+{
+    return hostPsp;
+}
+
+void setASP(void)
+{
+}
+
+void setTMPL(void)
+{
+}
+
+void pushREGS(void)
+{
+}
+
+void popREGS(void)
+{
+}
+
+void applySramRegions(const uint32_t base[], const uint32_t attr[])
+{
+}
+
+uint32_t countLeadingZeros(uint32_t value)
+{
+    return (value == 0) ? 32 : __builtin_clz(value);
+}
+
+bool isUnprivileged(void)
+{
+    return false;
+}
+
+uint32_t raiseBasePri(uint32_t basePri)
+{
+    return 0;
+}
+
+void setBasePri(uint32_t basePri)
+{
+}
+
+void putsUart0(char* str)
+{
+}
+
+uint32_t writeUart0(const char str[], uint32_t len)
+{
+    return len;
+}
+
+uint32_t readUart0(char str[], uint32_t len)
+{
+    return 0;
+}
+
+uint32_t availableUart0(void)
+{
+    return 0;
+}
+
+bool startUart0Dma(const char str[], uint32_t len)
+{
+    return true;
+}
+
+void StringCopy(char* source, char* destination)
+{
+    strcpy(destination, source);
+}
+
+int cmpStr(const char* string1, const char* string2)
+{
+    return strcmp(string1, string2);
+}
+
+//-----------------------------------------------------------------------------
+// Processor model
+//-----------------------------------------------------------------------------
+
+uint64_t hostCycles;                // cycles since hostInit()
+uint32_t hostTickLeft;              // cycles until SysTick counts down to zero
+uint32_t hostSysTicks;              // SysTick interrupts taken
+uint32_t hostTickWrites;            // writes to SysTick CURRENT by the kernel
+
+void hostMap(uintptr_t base, size_t size)
+{
+    void *p = mmap((void*)base, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p != (void*)base)
+    {
+        fprintf(stderr, "cannot map target memory at 0x%08lX\n", (unsigned long)base);
+        exit(2);
+    }
+}
+
+// Maps the target memory and sets up the kernel as main() does
+void hostInit(void)
+{
+    hostMap(0x20000000, 0x8000);
+    hostMap(0xE0001000, 0x1000);
+    hostMap(0xE000E000, 0x1000);
+    initRtos();
+    hostCycles = 0;
+    hostSysTicks = 0;
+    hostTickWrites = 0;
+    hostTickLeft = NVIC_ST_RELOAD_R + 1;
+    NVIC_ST_CURRENT_R = hostTickLeft;
+}
+
+// Picks up a write to SysTick CURRENT: the counter clears and reloads from
+// RELOAD on the next cycle, without an interrupt
+void hostSyncSysTick(void)
+{
+    if (NVIC_ST_CURRENT_R == 0)
+    {
+        hostTickLeft = NVIC_ST_RELOAD_R + 1;
+        hostTickWrites++;
+    }
+    NVIC_ST_CURRENT_R = hostTickLeft;
+}
+
+// Takes PendSV if kernel code pended it, as an exception return would
+void hostPendSv(void)
+{
+    hostSyncSysTick();
+    while (NVIC_INT_CTRL_R & NVIC_INT_CTRL_PEND_SV)
+    {
+        NVIC_INT_CTRL_R = 0;
+        pendSvIsr();
+        hostSyncSysTick();
+    }
+    NVIC_INT_CTRL_R = 0;
+}
+
+// Dispatches the first thread
+void hostLaunch(void)
+{
+    svcLaunch();
+    hostSyncSysTick();
+}
+
+// Runs the current thread for up to n cycles. Stops early when SysTick
+// reaches zero; the tick and any switch it causes are taken before
+// returning. Returns the cycles that passed.
+uint32_t hostRun(uint32_t n)
+{
+    uint32_t step = (n < hostTickLeft) ? n : hostTickLeft;
+    hostCycles += step;
+    DWT_CYCCNT_R += step;
+    hostTickLeft -= step;
+    NVIC_ST_CURRENT_R = hostTickLeft;
+    if (hostTickLeft == 0)
+    {
+        hostTickLeft = NVIC_ST_RELOAD_R + 1;        //the reload happens before the handler runs
+        NVIC_ST_CURRENT_R = hostTickLeft;
+        hostSysTicks++;
+        systickIsr();
+        hostPendSv();
+    }
+    return step;
+}
+
+// WFI: nothing happens until the next SysTick interrupt
+void hostWaitForTick(void)
+{
+    hostRun(hostTickLeft);
+}
+
+// A device interrupt at the current cycle: the handler (a FromIsr call)
+// runs first, then any PendSV it pended
+#define hostInterrupt(handler) do { handler; hostPendSv(); } while (0)
+
+// Entry point for the nth simulated thread. createThread() needs a distinct
+// one per thread but never calls it; the tool runs the thread's behaviour.
+#define hostThread(n) ((_fn)(uintptr_t)(0x100 + (n)))
+
+#endif
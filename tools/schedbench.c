@@ -0,0 +1,203 @@
+// Ready-queue scheduler benchmark (host)
+//
+// Times the bitmap ready queue in src/kernel.c (readyInsert(), readyRemove()
+// and the CLZ lookup in rtosScheduler()) against the linear TCB scan it
+// replaced, copied below from the original kernel. Both run over the same
+// TCBs in priority mode:
+//   - pick:       one scheduler call
+//   - block/wake: a thread leaves the READY state, the scheduler picks
+//                 another one, and the thread becomes READY again
+// Each is measured with every thread READY and with one in eight READY.
+// Threads get random priorities 0-14 and thread 0 is the idle thread at 15.
+// Every pick is checked to be a thread of the highest READY priority.
+//
+// The table size is MAX_TASKS, set when building. Task indices are uint8_t
+// with 0xFF as NO_TASK, so 255 is the largest size the kernel supports.
+//
+// Build and run from the repository root, once per size:
+//   gcc -O2 -no-pie -Isrc -DMAX_TASKS=64 -o schedbench tools/schedbench.c
+//   ./schedbench [seed]
+
+#include <time.h>
+
+#include "hostkernel.h"
+
+#define ITERATIONS 2000000
+
+uint32_t errors = 0;
+volatile uint8_t sink;
+
+// Priority scheduler before the ready queue: a scan of every TCB for the
+// highest READY priority, then a second scan for round-robin at that level
+uint8_t linearScheduler(void)
+{
+    static uint8_t task = 0xFF;
+    static uint8_t LastRanTask[NUM_PRIORITIES] = {0xFF};   //Array to track the last task at each prio level
+    uint8_t HighestPriority = 16;       //Start checking from lowest priority
+    uint8_t i = 0;
+
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        //Go through each tcb index and look for READY threads at the updated priority level
+        if (tcb[i].state == STATE_READY && tcb[i].priority < HighestPriority)
+        {
+            HighestPriority = tcb[i].priority;  //update the priority level found and keep going lower if tasks at higher prio are found
+            task = i;                           //Sets the task index for the READY task
+        }
+    }
+
+    //Round robin at a priority level when there are multiple tasks
+    if (task != 0xFF)
+    {
+        //start from the last scheduled task in that priority level + 1
+        uint8_t LastScheduledTask = (LastRanTask[HighestPriority] + 1) % taskCount;
+        uint8_t j = 0;
+        for (j = 0; j < taskCount; j++)
+        {
+            uint8_t taskIndex = (LastScheduledTask + j) % taskCount;
+            if (tcb[taskIndex].state == STATE_READY && tcb[taskIndex].priority == HighestPriority)
+            {
+                task = taskIndex;
+                LastRanTask[HighestPriority] = taskIndex;   //update the last scheduled index for this priority
+                break;
+            }
+        }
+    }
+    return task;
+}
+
+uint64_t nanoseconds(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+// Fills the TCBs, making about one thread in readyOneIn READY (always the idle thread)
+void setupThreads(uint8_t readyOneIn)
+{
+    uint16_t i;
+    initRtos();
+    schedulerMode = SCHED_PRIO;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        tcb[i].priority = (i == 0) ? IDLE_PRIORITY : rand() % IDLE_PRIORITY;
+        tcb[i].currentPriority = tcb[i].priority;
+        tcb[i].relDeadline = 0;
+        if (i == 0 || rand() % readyOneIn == 0)
+        {
+            tcb[i].state = STATE_READY;
+            readyInsert(i);
+        }
+        else
+        {
+            tcb[i].state = STATE_DELAYED;
+        }
+    }
+    taskCount = MAX_TASKS;
+}
+
+uint8_t highestReady(void)
+{
+    uint8_t prio = IDLE_PRIORITY;
+    uint16_t i;
+    for (i = 0; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].state == STATE_READY && tcb[i].priority < prio)
+            prio = tcb[i].priority;
+    }
+    return prio;
+}
+
+void check(const char *scheduler, uint8_t task)
+{
+    if (task >= MAX_TASKS || tcb[task].state != STATE_READY || tcb[task].priority != highestReady())
+    {
+        if (errors++ < 10)
+            printf("FAIL: %s picked thread %u\n", scheduler, task);
+    }
+}
+
+// A random READY thread other than idle, or thread 0 if there is none
+uint8_t randomReady(void)
+{
+    uint16_t i, n = 0;
+    uint8_t ready[MAX_TASKS];
+    for (i = 1; i < MAX_TASKS; i++)
+    {
+        if (tcb[i].state == STATE_READY)
+            ready[n++] = i;
+    }
+    return (n == 0) ? 0 : ready[rand() % n];
+}
+
+double timePick(bool bitmap)
+{
+    uint64_t t0 = nanoseconds();
+    uint32_t n;
+    for (n = 0; n < ITERATIONS; n++)
+    {
+        sink = bitmap ? rtosScheduler() : linearScheduler();
+    }
+    return (double)(nanoseconds() - t0) / ITERATIONS;
+}
+
+double timeBlockWake(bool bitmap)
+{
+    uint8_t task = randomReady();
+    uint64_t t0;
+    uint32_t n;
+    if (task == 0)
+        return 0;
+    t0 = nanoseconds();
+    for (n = 0; n < ITERATIONS; n++)
+    {
+        if (bitmap)
+        {
+            readyRemove(task);
+            tcb[task].state = STATE_BLOCKED_SEMAPHORE;
+            sink = rtosScheduler();
+            tcb[task].state = STATE_READY;
+            readyInsert(task);
+        }
+        else
+        {
+            tcb[task].state = STATE_BLOCKED_SEMAPHORE;
+            sink = linearScheduler();
+            tcb[task].state = STATE_READY;
+        }
+    }
+    return (double)(nanoseconds() - t0) / ITERATIONS;
+}
+
+void run(const char *name, uint8_t readyOneIn)
+{
+    uint32_t n;
+    double linearPick, bitmapPick, linearBlock, bitmapBlock;
+
+    setupThreads(readyOneIn);
+    for (n = 0; n < 1000; n++)
+    {
+        check("linear scan", linearScheduler());
+        check("ready queue", rtosScheduler());
+    }
+    linearPick = timePick(false);
+    bitmapPick = timePick(true);
+    linearBlock = timeBlockWake(false);
+    bitmapBlock = timeBlockWake(true);
+    printf("%-10s %8.1f %8.1f %12.1f %12.1f\n", name, linearPick, bitmapPick, linearBlock, bitmapBlock);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t seed = (argc > 1) ? strtoul(argv[1], 0, 0) : 1;
+
+    hostInit();
+    srand(seed);
+    printf("%u threads, ns per operation\n", MAX_TASKS);
+    printf("%-10s %8s %8s %12s %12s\n", "ready", "scan", "bitmap", "scan blk/wk", "bitmap blk/wk");
+    run("all", 1);
+    run("1 in 8", 8);
+    printf("%s (%u errors)\n", errors ? "FAIL" : "PASS", errors);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+// Periodic workload simulation (host)
+//
+// Runs periodic task sets on src/kernel.c through the host harness, once
+// in priority mode with rate-monotonic priorities (shorter period, higher
+// priority) and once in EDF mode. Each thread is created with
+// createPeriodicThread(), runs its execution time and ends the job with
+// waitNextPeriod(), so releases, preemption and the deadline-miss count
+// are the kernel's own. The sets range from below the Liu & Layland bound
+// for rate-monotonic scheduling, n(2^(1/n) - 1), through sets above it up
+// to overload. For every set and mode the misses counted by the kernel are
+// printed per thread, and two results from scheduling theory are checked:
+//   - below the RM bound, priority mode misses no deadline
+//   - at or below 100% utilisation, EDF misses no deadline
+// A last run checks that a sleep() in the middle of a job leaves the
+// release and deadline of a thread using waitNextPeriod() where they were.
+//
+// Each job finishes JOB_MARGIN cycles before its last tick ends, leaving
+// room for the kernel as on the target.
+//
+// Build and run from the repository root:
+//   gcc -O2 -no-pie -Isrc -o schedsim tools/schedsim.c -lm
+//   ./schedsim [ticks]
+
+#include <math.h>
+#include <sys/types.h>
+
+#include "hostkernel.h"
+
+// unistd.h and sys/wait.h would clash with the kernel's sleep() and wait()
+pid_t fork(void);
+pid_t waitpid(pid_t pid, int *status, int options);
+
+#define MAX_SET     4
+#define JOB_MARGIN  400
+
+typedef struct _taskSet
+{
+    const char *name;
+    uint8_t count;
+    uint32_t period[MAX_SET];       // ms, also the deadline
+    uint32_t execution[MAX_SET];    // ms of CPU per job
+} taskSet;
+
+const taskSet sets[] =
+{
+    {"U=0.70",           3, {10, 20, 40}, {3, 4, 8}},
+    {"U=0.77",           3, {10, 15, 35}, {3, 4, 7}},
+    {"U=0.90 harmonic",  3, {10, 20, 40}, {4, 6, 8}},
+    {"U=0.96",           3, {10, 15, 35}, {4, 5, 8}},
+    {"U=0.97",           2, {5, 7},       {2, 4}},
+    {"U=1.00",           3, {4, 6, 12},   {1, 3, 3}},
+    {"U=1.10 overload",  2, {10, 20},     {6, 10}},
+};
+
+uint32_t work[MAX_TASKS];           // cycles left in the running job
+uint32_t jobs[MAX_TASKS];           // jobs completed
+
+double utilisation(const taskSet *set)
+{
+    double u = 0;
+    uint8_t i;
+    for (i = 0; i < set->count; i++)
+    {
+        u += (double)set->execution[i] / set->period[i];
+    }
+    return u;
+}
+
+// Runs one set in one mode; returns the deadline misses
+uint32_t simulate(const taskSet *set, uint8_t mode, uint32_t duration)
+{
+    uint32_t misses = 0;
+    uint8_t i, task, rank;
+    bool ok;
+
+    schedulerMode = mode;
+    preemption = true;
+    ok = createThread(hostThread(0), "Idle", 15, 512);
+    for (i = 0; i < set->count; i++)
+    {
+        rank = 0;                                   //rate-monotonic: count the shorter periods
+        for (task = 0; task < set->count; task++)
+        {
+            if (set->period[task] < set->period[i] || (set->period[task] == set->period[i] && task < i))
+                rank++;
+        }
+        ok &= createPeriodicThread(hostThread(i + 1), "Periodic", 1 + rank, 512, set->period[i], 0);
+        work[i + 1] = set->execution[i] * CYCLES_PER_TICK - JOB_MARGIN;
+    }
+    if (!ok)
+    {
+        printf("threads not created\n");
+        exit(2);
+    }
+
+    hostLaunch();
+    while (systemTicks < duration)
+    {
+        task = taskCurrent;
+        if (task == 0)
+        {
+            hostWaitForTick();                      //WFI
+            svcYield();
+            hostPendSv();
+        }
+        else if (work[task] > 0)
+        {
+            work[task] -= hostRun(work[task]);
+        }
+        else
+        {
+            jobs[task]++;
+            work[task] = set->execution[task - 1] * CYCLES_PER_TICK - JOB_MARGIN;
+            svcWaitNextPeriod();
+            hostPendSv();
+        }
+    }
+
+    printf("  %-4s", (mode == SCHED_EDF) ? "EDF" : "PRIO");
+    for (i = 1; i <= set->count; i++)
+    {
+        uint32_t missed = periodics[tcb[i].periodic].deadlineMisses;
+        printf("  T=%-3u C=%-2u %5u/%-5u", set->period[i - 1], set->execution[i - 1], missed, jobs[i]);
+        misses += missed;
+    }
+    printf("  misses %u\n", misses);
+    return misses;
+}
+
+// Runs a periodic thread into its second job and sleeps it mid-job;
+// returns true if its release and deadline did not move
+bool sleepKeepsSchedule(void)
+{
+    uint32_t release, deadline;
+    periodicThread *p;
+
+    preemption = true;
+    createThread(hostThread(0), "Idle", 15, 512);
+    createPeriodicThread(hostThread(1), "Periodic", 1, 512, 10, 0);
+    p = &periodics[tcb[1].periodic];
+    hostLaunch();
+    hostRun(CYCLES_PER_TICK / 2);
+    svcWaitNextPeriod();
+    hostPendSv();
+    while (taskCurrent != 1)
+    {
+        hostWaitForTick();
+    }
+    release = p->release;
+    deadline = tcb[1].absDeadline;
+    hostRun(2 * CYCLES_PER_TICK);
+    svcSleep(3);
+    hostPendSv();
+    while (taskCurrent != 1)
+    {
+        hostWaitForTick();
+    }
+    printf("sleep() mid-job: release %u -> %u, deadline %u -> %u\n", release, p->release, deadline, tcb[1].absDeadline);
+    return p->release == release && tcb[1].absDeadline == deadline;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t duration = (argc > 1) ? strtoul(argv[1], 0, 0) : 100000;
+    uint32_t errors = 0;
+    uint8_t s, m;
+    static const uint8_t modes[] = {SCHED_PRIO, SCHED_EDF};
+    int status;
+
+    hostInit();
+    printf("%u ticks per run, misses/jobs per thread\n", duration);
+    for (s = 0; s < sizeof(sets) / sizeof(sets[0]); s++)
+    {
+        double u = utilisation(&sets[s]);
+        double bound = sets[s].count * (pow(2.0, 1.0 / sets[s].count) - 1);
+        printf("%s (U=%.3f, RM bound %.3f)\n", sets[s].name, u, bound);
+        fflush(stdout);
+        for (m = 0; m < 2; m++)
+        {
+            if (fork() == 0)
+            {
+                //each run gets a fresh kernel and heap
+                uint32_t misses = simulate(&sets[s], modes[m], duration);
+                bool expectNone = (modes[m] == SCHED_PRIO) ? (u <= bound) : (u <= 1.0 + 1e-9);
+                fflush(stdout);
+                exit((expectNone && misses != 0) ? 1 : 0);
+            }
+            waitpid(-1, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+                printf("FAIL: deadlines missed where none should be\n");
+                errors++;
+            }
+        }
+    }
+    if (fork() == 0)
+    {
+        exit(sleepKeepsSchedule() ? 0 : 1);
+    }
+    waitpid(-1, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        printf("FAIL: sleep() moved the schedule of a periodic thread\n");
+        errors++;
+    }
+    printf("%s (%u errors)\n", errors ? "FAIL" : "PASS", errors);
+    return errors ? 1 : 0;
+}
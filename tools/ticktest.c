@@ -0,0 +1,170 @@
+// Tickless idle test (host)
+//
+// Runs src/kernel.c on the host harness with SysTick counted down cycle by
+// cycle, so timerInsert(), advanceTimers() and updateTickMode() see the
+// stretched periods they program. The threads are:
+//   - Idle at priority 15, which waits for an interrupt and yields
+//   - sleepers that run for a random time and sleep() a random 1-500 ticks
+//   - a waiter blocked on a semaphore that a simulated device interrupt
+//     posts at random cycles, cutting stretched periods short
+// Every sleeper wakeup is checked:
+//   - it happens on the tick the sleep was due, by systemTicks
+//   - the cycles that passed are within a tick of the requested delay
+// and systemTicks is checked against the cycle count throughout; each write
+// to SysTick CURRENT may put the tick boundaries one cycle later. The number
+// of SysTick interrupts taken is printed next to the ticks that passed.
+//
+// Build and run from the repository root:
+//   gcc -O2 -no-pie -Isrc -o ticktest tools/ticktest.c
+//   ./ticktest [seed] [ticks]
+
+#include "hostkernel.h"
+
+#define SLEEPERS      4
+#define WAITER        (SLEEPERS + 1)
+#define SEMAPHORE     0
+#define IRQ_MEAN      (300 * CYCLES_PER_TICK)   // average time between device interrupts
+#define TOLERANCE     1000                      // cycles, the margin updateTickMode() keeps
+
+typedef struct _sleeper
+{
+    bool sleeping;
+    uint32_t ticks;             // requested delay
+    uint32_t dueTick;           // systemTicks it must wake on
+    uint64_t startCycles;       // cycle count at the sleep() call
+} sleeper;
+
+sleeper sleepers[MAX_TASKS];
+uint32_t work[MAX_TASKS];       // cycles the thread runs before its next call
+uint32_t errors = 0;
+uint32_t wakeups = 0;
+uint32_t interrupts = 0;
+uint8_t idleStep = 0;           // 0: scanStacks(), 1: WFI, 2: yield()
+
+void fail(const char *what, uint8_t task, uint64_t value)
+{
+    if (errors++ < 10)
+    {
+        printf("FAIL: %s (thread %u, tick %u, %llu)\n", what, task, systemTicks, (unsigned long long)value);
+    }
+}
+
+uint32_t randomWork(void)
+{
+    return rand() % (2 * CYCLES_PER_TICK);
+}
+
+void checkWakeups(void)
+{
+    uint8_t task;
+    uint64_t elapsed;
+    for (task = 1; task <= SLEEPERS; task++)
+    {
+        if (sleepers[task].sleeping && tcb[task].state != STATE_DELAYED)
+        {
+            sleepers[task].sleeping = false;
+            wakeups++;
+            elapsed = hostCycles - sleepers[task].startCycles;
+            if (systemTicks != sleepers[task].dueTick)
+            {
+                fail("woke on the wrong tick", task, sleepers[task].dueTick);
+            }
+            if (elapsed + CYCLES_PER_TICK < (uint64_t)sleepers[task].ticks * CYCLES_PER_TICK
+                || elapsed > (uint64_t)sleepers[task].ticks * CYCLES_PER_TICK + TOLERANCE)
+            {
+                fail("delay does not match the cycles that passed", task, elapsed);
+            }
+        }
+    }
+    //a stretched period holds back systemTicks until it ends
+    if (hostCycles > (uint64_t)(systemTicks + stretchTicks) * CYCLES_PER_TICK + hostTickWrites
+        || hostCycles + TOLERANCE < (uint64_t)systemTicks * CYCLES_PER_TICK)
+    {
+        fail("systemTicks strayed from the cycle count", 0, hostCycles);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t seed = (argc > 1) ? strtoul(argv[1], 0, 0) : 1;
+    uint32_t duration = (argc > 2) ? strtoul(argv[2], 0, 0) : 1000000;
+    uint64_t nextIrq, cycles;
+    uint8_t task;
+    bool ok;
+
+    srand(seed);
+    hostInit();
+    preemption = true;
+    initSemaphore(SEMAPHORE, 0, QUEUE_PRIO);
+    ok = createThread(hostThread(0), "Idle", 15, 512);
+    for (task = 1; task <= SLEEPERS; task++)
+    {
+        ok &= createThread(hostThread(task), "Sleeper", 4 + task, 512);
+        work[task] = randomWork();
+    }
+    ok &= createThread(hostThread(WAITER), "Waiter", 2, 512);
+    if (!ok)
+    {
+        printf("FAIL: threads not created\n");
+        return 1;
+    }
+
+    nextIrq = rand() % (2 * IRQ_MEAN);
+    hostLaunch();
+    while (systemTicks < duration)
+    {
+        if (hostCycles >= nextIrq)
+        {
+            hostInterrupt(postFromIsr(SEMAPHORE));
+            interrupts++;
+            nextIrq = hostCycles + 1 + rand() % (2 * IRQ_MEAN);
+        }
+        else if (taskCurrent == 0)
+        {
+            if (idleStep == 0)
+            {
+                svcScanStacks();
+                hostPendSv();
+            }
+            else if (idleStep == 1)
+            {
+                hostRun(nextIrq - hostCycles);      //WFI until SysTick or the device interrupt
+            }
+            else
+            {
+                svcYield();
+                hostPendSv();
+            }
+            idleStep = (idleStep + 1) % 3;
+        }
+        else if (work[taskCurrent] > 0)
+        {
+            task = taskCurrent;                     //a tick may switch threads inside hostRun()
+            cycles = (nextIrq - hostCycles < work[task]) ? nextIrq - hostCycles : work[task];
+            work[task] -= hostRun(cycles);
+        }
+        else if (taskCurrent == WAITER)
+        {
+            work[WAITER] = rand() % (CYCLES_PER_TICK / 4);
+            svcWait(SEMAPHORE);
+            hostPendSv();
+        }
+        else
+        {
+            task = taskCurrent;
+            sleepers[task].sleeping = true;
+            sleepers[task].ticks = 1 + rand() % 500;
+            sleepers[task].dueTick = systemTicks + sleepers[task].ticks;
+            sleepers[task].startCycles = hostCycles;
+            work[task] = randomWork();
+            svcSleep(sleepers[task].ticks);
+            hostPendSv();
+        }
+        checkWakeups();
+    }
+
+    printf("seed %u: %u ticks, %u SysTick interrupts, %u device interrupts, %u wakeups checked\n",
+           seed, systemTicks, hostSysTicks, interrupts, wakeups);
+    printf("%s (%u errors)\n", errors ? "FAIL" : "PASS", errors);
+    return errors ? 1 : 0;
+}